@@ -1,5 +1,6 @@
 from Transactions import Transactions
 import os 
+import sys
 
 def main():
     #Main function to load, process, and append transactions.
@@ -8,6 +9,11 @@ def main():
     games_collection_file = '../data/gamescollection.txt'
     daily_transactions_file = '../data/dailytransactions.txt'
 
+    # With --binary-journal, read the checksummed journal the front end writes alongside the text file;
+    # the text file is read instead if the journal is damaged or behind it
+    if '--binary-journal' in sys.argv[1:]:
+        daily_transactions_file += '.bin'
+
     # Process transactions and append them to the respective files
     transactions = Transactions()
     transactions.process_transactions(daily_transactions_file, user_accounts_file, available_games_file, games_collection_file)
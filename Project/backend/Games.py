@@ -6,12 +6,19 @@ class Games:
 
     @staticmethod
     def buy_game(line_04, games_collection, user_accounts, available_games):
-        utility = Utilities()
         parts = line_04.split()
-        game_price = float(parts[-1])
+        game_price = parts[-1]
         buyer_username = parts[-2]
         seller_username = parts[-3]
         game_name = ' '.join(parts[1:-3])  # Adjusted for transaction code and price/seller/buyer.
+        Games.buy_game_record(game_name, seller_username, buyer_username, game_price,
+                              games_collection, user_accounts, available_games)
+
+    @staticmethod
+    def buy_game_record(game_name, seller_username, buyer_username, game_price, games_collection, user_accounts, available_games):
+        # Move the game of a '04' record into the buyer's collection and its price from the buyer to the seller.
+        utility = Utilities()
+        game_price = float(game_price)
 
         # Check if the game exists in the available games file.
         with open(available_games, 'r') as file:
@@ -103,13 +110,19 @@ class Games:
     @staticmethod
     def sell_game(line_03, available_games, user_accounts):
     # Extract game name, seller, and price from the line, taking into account spaces in the game name.
-        utility = Utilities()
         parts = line_03.split()
         price = parts[-1]
         seller = parts[-2]
         game_name = ' '.join(parts[1:-2])  # Skip the first part (transaction code) and the last two parts (seller and price).
+        Games.sell_game_record(game_name, seller, price, available_games, user_accounts)
+
+    @staticmethod
+    def sell_game_record(game_name, seller, price, available_games, user_accounts):
+        # Add the game of a '03' record to the available games.
+        utility = Utilities()
 
-        if len(game_name) > 19:
+        # The daily file's column holds 19 characters, the available games file's 25
+        if len(game_name) > 25:
             print(f"ERROR: the name of the game '{game_name}' is too long.")
             return
 
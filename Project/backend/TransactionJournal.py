@@ -0,0 +1,187 @@
+import os
+import struct
+import sys
+
+# Binary transaction journal written by the front end with --binary-journal ("<daily transaction file>.bin").
+# After the 8-byte header (b'SDTJ', version 1) every frame is, little-endian:
+#   u32 payload length, u32 CRC32C of the payload, payload:
+#   u64 sequence, u8 code, u8 field count, per field (u16 length, bytes), i64 cents
+MAGIC = b'SDTJ'
+VERSION = 1
+HEADER_LENGTH = 8
+
+
+def _crc32c_tables():
+    # Tables for slicing by 8: tables[k][b] is the CRC of byte b followed by k zero bytes
+    first = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ (0x82F63B78 if crc & 1 else 0)
+        first.append(crc)
+    tables = [first]
+    for _ in range(7):
+        previous = tables[-1]
+        tables.append([(previous[i] >> 8) ^ first[previous[i] & 0xFF] for i in range(256)])
+    return tables
+
+
+_T0, _T1, _T2, _T3, _T4, _T5, _T6, _T7 = _crc32c_tables()
+
+
+def _crc32c_python(data):
+    # Eight bytes per step; the tail byte by byte
+    crc = 0xFFFFFFFF
+    whole = len(data) - len(data) % 8
+    for (word,) in struct.iter_unpack('<Q', data[:whole]):
+        low = (word & 0xFFFFFFFF) ^ crc
+        high = word >> 32
+        crc = (_T7[low & 0xFF] ^ _T6[(low >> 8) & 0xFF] ^ _T5[(low >> 16) & 0xFF] ^ _T4[low >> 24] ^
+               _T3[high & 0xFF] ^ _T2[(high >> 8) & 0xFF] ^ _T1[(high >> 16) & 0xFF] ^ _T0[high >> 24])
+    for byte in data[whole:]:
+        crc = (crc >> 8) ^ _T0[(crc ^ byte) & 0xFF]
+    return crc ^ 0xFFFFFFFF
+
+
+# Use a compiled CRC32C when one is installed
+try:
+    from crc32c import crc32c
+except ImportError:
+    try:
+        import google_crc32c
+
+        def crc32c(data):
+            return google_crc32c.value(bytes(data))
+    except ImportError:
+        crc32c = _crc32c_python
+
+
+def is_journal(path):
+    # Check whether a file starts with the journal header rather than a text record
+    try:
+        with open(path, 'rb') as file:
+            return file.read(len(MAGIC)) == MAGIC
+    except OSError:
+        return False
+
+
+def read_journal(path):
+    # Read the records of a journal as (sequence, code, fields, cents) tuples, with the names at full length,
+    # and whether it was read whole. Stops at a torn last frame or a corrupt one, and reports it and any gap
+    # in the sequence numbers; the journal is then not whole.
+    with open(path, 'rb') as file:
+        data = memoryview(file.read())
+
+    if len(data) < HEADER_LENGTH or data[:4] != MAGIC or struct.unpack_from('<I', data, 4)[0] != VERSION:
+        print(f"ERROR: The file {path} is not a binary transaction journal.")
+        return [], False
+
+    records = []
+    whole = True
+    offset = HEADER_LENGTH
+    while offset < len(data):
+        if len(data) - offset < 8:
+            print(f"ERROR: Torn frame at byte {offset} of {path}.")
+            whole = False
+            break
+        length, checksum = struct.unpack_from('<II', data, offset)
+        payload = data[offset + 8:offset + 8 + length]
+        if len(payload) < length or (offset + 8 + length == len(data) and (length < 18 or crc32c(payload) != checksum)):
+            print(f"ERROR: Torn frame at byte {offset} of {path}.")
+            whole = False
+            break
+        if length < 18 or crc32c(payload) != checksum:
+            print(f"ERROR: Corrupt frame at byte {offset} of {path}; the frames after it are not read.")
+            whole = False
+            break
+
+        sequence, code, field_count = struct.unpack_from('<QBB', payload, 0)
+        position = 10
+        fields = []
+        for _ in range(field_count):
+            (field_length,) = struct.unpack_from('<H', payload, position)
+            fields.append(str(payload[position + 2:position + 2 + field_length], 'utf-8', 'replace'))
+            position += 2 + field_length
+        (cents,) = struct.unpack_from('<q', payload, position)
+
+        if records and sequence != records[-1][0] + 1:
+            print(f"ERROR: Sequence gap in {path} between {records[-1][0]} and {sequence}.")
+            whole = False
+        records.append((sequence, code, fields, cents))
+        offset += 8 + length
+    return records, whole
+
+
+def text_file_of(path):
+    # Daily transaction file the journal was written alongside
+    return path[:-len('.bin')] if path.endswith('.bin') else path
+
+
+def read_current_journal(path):
+    # Records of a journal that was read whole and holds as many records as its text file, or None.
+    # A journal the front end stopped writing (after finding it corrupt, or by a crash between the two
+    # files) falls behind the text file, and only the text file then holds the whole day.
+    records, whole = read_journal(path)
+    if not whole:
+        return None
+
+    text_path = text_file_of(path)
+    if not os.path.exists(text_path):
+        print(f"ERROR: The file {text_path} does not exist.")
+        return None
+    with open(text_path, 'r') as file:
+        text_records = sum(1 for line in file if line.strip())
+    if text_records != len(records):
+        print(f"ERROR: {path} holds {len(records)} records but {text_path} holds {text_records}.")
+        return None
+    return records
+
+
+def format_amount(cents, width):
+    # Amount as the front end writes it, e.g. 4500 cents at width 9 is "000045.00"
+    return f"{cents // 100}.{cents % 100:02d}".rjust(width, '0')
+
+
+def to_legacy_line(code, fields, cents):
+    # Record as the front end writes it to the daily transaction file, names truncated to their columns
+    if code == 5:
+        seller, buyer = fields
+        return f"05 {seller[:15].ljust(15, '_')} {buyer[:15].ljust(15, '_')} {format_amount(cents, 9)}\n"
+    if code == 3:
+        game, seller = fields
+        return f"03 {game[:19]:<19} {seller[:13]:<13} {format_amount(cents, 6)}\n"
+    if code == 4:
+        game, seller, buyer = fields
+        return f"04 {game[:19]:<19} {seller[:15]:<15} {buyer[:14]:<14} {format_amount(cents, 6)}\n"
+    username, user_type = fields
+    return f"{code:02d} {username[:16]:<16}{user_type[:2]:<2} {format_amount(cents, 9)}\n"
+
+
+def legacy_lines(path):
+    # Records of a journal as daily transaction file lines, or None if it was not read whole
+    records, whole = read_journal(path)
+    if not whole:
+        return None
+    return [to_legacy_line(code, fields, cents) for _, code, fields, cents in records]
+
+
+def convert(journal_path, text_path):
+    # Convert a journal to the legacy daily transaction file format; returns the number of records, or None
+    # without writing anything if the journal was not read whole
+    lines = legacy_lines(journal_path)
+    if lines is None:
+        return None
+    with open(text_path, 'w') as file:
+        file.writelines(lines)
+    return len(lines)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        print("Usage: python TransactionJournal.py <journal_file> <text_file>")
+        sys.exit(1)
+    converted = convert(sys.argv[1], sys.argv[2])
+    if converted is None:
+        print("The journal was not converted.")
+        sys.exit(1)
+    print(f"Converted {converted} transactions.")
@@ -1,6 +1,7 @@
 import os
 from UserAccounts import UserAccounts
 from Games import Games
+import TransactionJournal
 
 class Transactions: 
     def __init__(self):
@@ -17,29 +18,74 @@ class Transactions:
         games = Games()
         useraccounts = UserAccounts()
 
-        # Process transactions and append them to the respective files. 
+        # A binary journal is processed record by record, with the names at full length; one that is not whole
+        # or has fallen behind its text file is not, and the text file is processed instead
+        if TransactionJournal.is_journal(transactions):
+            records = TransactionJournal.read_current_journal(transactions)
+            if records is not None:
+                Transactions.process_journal_records(records, useraccounts, games, user_accounts, available_games, games_collection)
+                return
+
+            transactions = TransactionJournal.text_file_of(transactions)
+            print(f"ERROR: The binary journal cannot be used; processing {transactions} instead.")
+            if not os.path.exists(transactions):
+                print(f"ERROR: The file {transactions} does not exist.")
+                return
+
         with open(transactions, 'r') as file:
-            for line in file:
-                if line.startswith('01'):
-                    useraccounts.create_account(line, user_accounts)
-                    print('Create user account transaction')
-                elif line.startswith('02'):
-                    useraccounts.delete_account(line, user_accounts)
-                    print('Deleted account transaction')
-                elif line.startswith('03'):
-                    games.sell_game(line, available_games, user_accounts)
-                    print('Sell game transaction')
-                elif line.startswith('04'):
-                    games.buy_game(line, games_collection, user_accounts, available_games)
-                    print('Buy game transaction')
-                elif line.startswith('05'):
-                    useraccounts.refund(line, user_accounts)
-                    print('Refund transaction')
-                elif line.startswith('06'):
-                    useraccounts.add_credit(line, user_accounts)
-                    print('Add credit transaction')
-                elif line.startswith('00'):
-                    print('End of transactions file')
-                else:
-                    print('ERROR: Invalid transaction code')
-                    
\ No newline at end of file
+            lines = file.readlines()
+
+        # Process transactions and append them to the respective files. 
+        for line in lines:
+            if line.startswith('01'):
+                useraccounts.create_account(line, user_accounts)
+                print('Create user account transaction')
+            elif line.startswith('02'):
+                useraccounts.delete_account(line, user_accounts)
+                print('Deleted account transaction')
+            elif line.startswith('03'):
+                games.sell_game(line, available_games, user_accounts)
+                print('Sell game transaction')
+            elif line.startswith('04'):
+                games.buy_game(line, games_collection, user_accounts, available_games)
+                print('Buy game transaction')
+            elif line.startswith('05'):
+                useraccounts.refund(line, user_accounts)
+                print('Refund transaction')
+            elif line.startswith('06'):
+                useraccounts.add_credit(line, user_accounts)
+                print('Add credit transaction')
+            elif line.startswith('00'):
+                print('End of transactions file')
+            else:
+                print('ERROR: Invalid transaction code')
+                
+
+    @staticmethod
+    def process_journal_records(records, useraccounts, games, user_accounts, available_games, games_collection):
+        # Process the (sequence, code, fields, cents) records of a binary journal, in the same way as their lines
+        for _, code, fields, cents in records:
+            amount = TransactionJournal.format_amount(cents, 0)
+            if code == 1:
+                useraccounts.create_account_record(fields[0], fields[1], amount, user_accounts)
+                print('Create user account transaction')
+            elif code == 2:
+                useraccounts.delete_account_record(fields[0], user_accounts)
+                print('Deleted account transaction')
+            elif code == 3:
+                games.sell_game_record(fields[0], fields[1], amount, available_games, user_accounts)
+                print('Sell game transaction')
+            elif code == 4:
+                games.buy_game_record(fields[0], fields[1], fields[2], amount, games_collection, user_accounts, available_games)
+                print('Buy game transaction')
+            elif code == 5:
+                # The record lists the seller before the buyer
+                useraccounts.refund_record(fields[1], fields[0], amount, user_accounts)
+                print('Refund transaction')
+            elif code == 6:
+                useraccounts.add_credit_record(fields[0], amount, user_accounts)
+                print('Add credit transaction')
+            elif code == 0:
+                print('End of transactions file')
+            else:
+                print('ERROR: Invalid transaction code')
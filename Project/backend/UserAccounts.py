@@ -8,10 +8,15 @@ class UserAccounts:
     def create_account(line_01, user_accounts):
     # Create a new user account and append it to the user_accounts list.
     # Getting the information from the line passed to the function.
-        utility = Utilities()
         username = line_01.split()[1]  # line_01 represents the line in the transactions file that starts with '01'.
         user_type = line_01.split()[2]
         credit = line_01.split()[3]
+        UserAccounts.create_account_record(username, user_type, credit, user_accounts)
+
+    @staticmethod
+    def create_account_record(username, user_type, credit, user_accounts):
+        # Create a new user account from the fields of a '01' record.
+        utility = Utilities()
         formatted_username = utility.format_username(username)
         formatted_credit = utility.format_credit(credit)
 
@@ -50,7 +55,11 @@ class UserAccounts:
     def delete_account(line_02, user_accounts):
         # Extract the username to delete from the provided line.
         username = line_02.split()[1]
+        UserAccounts.delete_account_record(username, user_accounts)
 
+    @staticmethod
+    def delete_account_record(username, user_accounts):
+        # Delete the user account named by a '02' record.
         user_found = False
         updated_accounts = []
 
@@ -80,10 +89,15 @@ class UserAccounts:
 
     @staticmethod
     def refund(line_05, user_accounts):
-        utility = Utilities()
         parts = line_05.split()
         buyer_username, seller_username = parts[1], parts[2]
-        amount = float(parts[3])  # Convert amount to float for arithmetic operations.
+        UserAccounts.refund_record(buyer_username, seller_username, parts[3], user_accounts)
+
+    @staticmethod
+    def refund_record(buyer_username, seller_username, amount, user_accounts):
+        # Move the amount of a '05' record from the seller back to the buyer.
+        utility = Utilities()
+        amount = float(amount)  # Convert amount to float for arithmetic operations.
 
         if amount < 0:
             print("ERROR: Invalid refund amount.")
@@ -145,10 +159,14 @@ class UserAccounts:
 
     @staticmethod
     def add_credit(line, user_accounts):
-        utility = Utilities()
         parts = line.split()
-        username = parts[1]
-        additional_credit = float(parts[3]) 
+        UserAccounts.add_credit_record(parts[1], parts[3], user_accounts)
+
+    @staticmethod
+    def add_credit_record(username, additional_credit, user_accounts):
+        # Add the amount of a '06' record to the user's credit.
+        utility = Utilities()
+        additional_credit = float(additional_credit)
 
         if additional_credit < 0:
             print("ERROR: Credit amount must be a positive number.")
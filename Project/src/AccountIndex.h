@@ -0,0 +1,463 @@
+#ifndef ACCOUNT_INDEX_H
+#define ACCOUNT_INDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "general.h"
+#include "User.h"
+#include "FixedDecimal.h"
+#include "MappedFile.h"
+#include "MasterFile.h"
+#include "PageCursor.h"
+
+// Orders in which the accounts can be listed
+enum AccountSortOrder
+{
+    SortAccountsByName,
+    SortAccountsByType,
+    SortAccountsByCredit,
+    AccountSortOrderCount
+};
+
+// An account as held by the account indexes
+struct AccountEntry
+{
+    std::string username;
+    int type;
+    int64_t creditCents;
+};
+
+// Comparison of account entries in one order; usernames are unique, so they break the ties
+struct AccountEntryLess
+{
+    AccountSortOrder order;
+
+    bool operator()(const AccountEntry &left, const AccountEntry &right) const
+    {
+        if (order == SortAccountsByType)
+            return std::tie(left.type, left.username) < std::tie(right.type, right.username);
+        if (order == SortAccountsByCredit)
+            return std::tie(left.creditCents, left.username) < std::tie(right.creditCents, right.username);
+        return left.username < right.username;
+    }
+};
+
+// Function to build an account entry from a 28-character accounts record; returns false if it is malformed
+inline bool parseAccountEntry(const char *record, AccountEntry &entry)
+{
+    entry.username.clear();
+    for (size_t i = 0; i < 16; i++)
+    {
+        if (record[i] != ' ')
+            entry.username.push_back(record[i]);
+    }
+    entry.type = getUserTypeFromCode(record[16], record[17]);
+    return !entry.username.empty() && entry.type != -1 && parseFixedDecimalCents(record + 19, 9, entry.creditCents);
+}
+
+// The accounts in one order, read by position
+class SortedAccounts
+{
+public:
+    SortedAccounts(AccountSortOrder order) : less{order} {}
+    virtual ~SortedAccounts() {}
+
+    virtual size_t size() const = 0;
+    virtual AccountEntry entry(size_t position) const = 0;
+
+    // Function to find the first position whose entry does not sort before the key
+    size_t lowerBound(const AccountEntry &key) const
+    {
+        return bound(key, false);
+    }
+
+    // Function to find the first position whose entry sorts after the key
+    size_t upperBound(const AccountEntry &key) const
+    {
+        return bound(key, true);
+    }
+
+    AccountSortOrder getOrder() const
+    {
+        return less.order;
+    }
+
+protected:
+    AccountEntryLess less;
+
+private:
+    size_t bound(const AccountEntry &key, bool upper) const
+    {
+        size_t first = 0;
+        size_t count = size();
+        while (count > 0)
+        {
+            size_t half = count / 2;
+            AccountEntry middle = entry(first + half);
+            if (upper ? !less(key, middle) : less(middle, key))
+            {
+                first += half + 1;
+                count -= half + 1;
+            }
+            else
+            {
+                count = half;
+            }
+        }
+        return first;
+    }
+};
+
+// Accounts sorted in memory from the account table
+class SortedAccountsInMemory : public SortedAccounts
+{
+public:
+    SortedAccountsInMemory(AccountSortOrder order, const std::vector<User> &users) : SortedAccounts(order)
+    {
+        entries.reserve(users.size());
+        for (const User &user : users)
+            entries.push_back(AccountEntry{user.getUsername(), user.getType(), amountToCents(user.getCredit())});
+        std::sort(entries.begin(), entries.end(), less);
+    }
+
+    size_t size() const override
+    {
+        return entries.size();
+    }
+
+    AccountEntry entry(size_t position) const override
+    {
+        return entries[position];
+    }
+
+private:
+    std::vector<AccountEntry> entries;
+};
+
+// Accounts read from a mapped file of sorted accounts records, one per line with no END record
+class SortedAccountsFile : public SortedAccounts
+{
+public:
+    static constexpr size_t lineLength = masterRecordLengths[AccountsFile] + 1;
+
+    SortedAccountsFile(AccountSortOrder order, const std::string &filename)
+        : SortedAccounts(order), file(filename) {}
+
+    bool isOpen() const
+    {
+        return file.isOpen() && file.size() % lineLength == 0;
+    }
+
+    size_t size() const override
+    {
+        return file.size() / lineLength;
+    }
+
+    AccountEntry entry(size_t position) const override
+    {
+        AccountEntry entry;
+        parseAccountEntry(record(position), entry);
+        return entry;
+    }
+
+    // Function to get the raw record at a position
+    const char *record(size_t position) const
+    {
+        return file.data() + position * lineLength;
+    }
+
+private:
+    MappedFile file;
+};
+
+// External merge sort of an accounts file into sorted runs merged through a heap, for tables too large to sort in memory
+class AccountFileSorter
+{
+public:
+    // Function to sort an accounts file into the output file; returns false if it cannot be read or written
+    static bool sort(const std::string &inputFilename, const std::string &outputFilename,
+                     AccountSortOrder order, size_t runRecords)
+    {
+        MappedFile input(inputFilename);
+        if (!input.isOpen())
+            return false;
+
+        const size_t recordLength = masterRecordLengths[AccountsFile];
+        AccountEntryLess less{order};
+        std::vector<std::string> runFilenames;
+        std::vector<RunRecord> run;
+        bool written = true;
+
+        auto writeRun = [&]()
+        {
+            std::sort(run.begin(), run.end(), [&less](const RunRecord &left, const RunRecord &right)
+                      { return less(left.entry, right.entry); });
+
+            runFilenames.push_back(outputFilename + ".run" + std::to_string(runFilenames.size()));
+            std::ofstream runFile(runFilenames.back(), std::ios::binary | std::ios::trunc);
+            for (const RunRecord &record : run)
+            {
+                runFile.write(input.data() + record.offset, recordLength);
+                runFile.put('\n');
+            }
+            written = written && !runFile.fail();
+            run.clear();
+        };
+
+        const char *data = input.data();
+        size_t size = input.size();
+        for (size_t offset = 0; offset < size && written;)
+        {
+            const void *newline = std::memchr(data + offset, '\n', size - offset);
+            size_t lineEnd = newline != nullptr ? static_cast<const char *>(newline) - data : size;
+            size_t length = lineEnd - offset;
+            if (length > 0 && data[lineEnd - 1] == '\r')
+                length--;
+
+            RunRecord record;
+            record.offset = offset;
+            if (length == recordLength && parseAccountEntry(data + offset, record.entry))
+            {
+                run.push_back(std::move(record));
+                if (run.size() == runRecords)
+                    writeRun();
+            }
+            offset = lineEnd + 1;
+        }
+        if (!run.empty() || runFilenames.empty())
+            writeRun();
+
+        if (written)
+            written = runFilenames.size() == 1 ? std::rename(runFilenames[0].c_str(), outputFilename.c_str()) == 0
+                                               : mergeRuns(runFilenames, outputFilename, order);
+
+        for (const std::string &runFilename : runFilenames)
+            std::remove(runFilename.c_str());
+        return written;
+    }
+
+private:
+    struct RunRecord
+    {
+        AccountEntry entry;
+        size_t offset;
+    };
+
+    // The next record of one run, waiting in the merge heap
+    struct MergeHead
+    {
+        AccountEntry entry;
+        size_t run;
+        size_t position;
+    };
+
+    static bool mergeRuns(const std::vector<std::string> &runFilenames, const std::string &outputFilename, AccountSortOrder order)
+    {
+        std::vector<std::unique_ptr<SortedAccountsFile>> runs;
+        for (const std::string &runFilename : runFilenames)
+        {
+            runs.emplace_back(new SortedAccountsFile(order, runFilename));
+            if (!runs.back()->isOpen())
+                return false;
+        }
+
+        AccountEntryLess less{order};
+        auto later = [&less](const MergeHead &left, const MergeHead &right)
+        {
+            return less(right.entry, left.entry);
+        };
+        std::priority_queue<MergeHead, std::vector<MergeHead>, decltype(later)> heads(later);
+        for (size_t run = 0; run < runs.size(); run++)
+        {
+            if (runs[run]->size() > 0)
+                heads.push(MergeHead{runs[run]->entry(0), run, 0});
+        }
+
+        std::string tempFilename = outputFilename + ".tmp";
+        std::ofstream output(tempFilename, std::ios::binary | std::ios::trunc);
+        while (!heads.empty())
+        {
+            MergeHead head = heads.top();
+            heads.pop();
+            output.write(runs[head.run]->record(head.position), SortedAccountsFile::lineLength);
+
+            if (++head.position < runs[head.run]->size())
+            {
+                head.entry = runs[head.run]->entry(head.position);
+                heads.push(std::move(head));
+            }
+        }
+        output.close();
+
+        if (output.fail() || std::rename(tempFilename.c_str(), outputFilename.c_str()) != 0)
+        {
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+// Sorted views of the account table, one per AccountSortOrder, built on first use and dropped when the accounts change
+class AccountIndex
+{
+public:
+    AccountIndex() {}
+    AccountIndex(const AccountIndex &) = delete;
+    AccountIndex &operator=(const AccountIndex &) = delete;
+
+    ~AccountIndex()
+    {
+        invalidate();
+    }
+
+    // Function to drop every sorted view after the accounts may have changed
+    void invalidate()
+    {
+        for (std::unique_ptr<SortedAccounts> &view : views)
+            view.reset();
+        for (const std::string &sortedFilename : sortedFilenames)
+            std::remove(sortedFilename.c_str());
+        sortedFilenames.clear();
+    }
+
+    // Function to get the accounts in one order, sorting them if the order has no current view
+    // accountsFilename is the accounts file if it matches the table, or "" if it is behind
+    const SortedAccounts &getSorted(AccountSortOrder order, const std::vector<User> &users,
+                                    const std::string &accountsFilename, size_t maxInMemoryRecords)
+    {
+        if (views[order] != nullptr)
+            return *views[order];
+
+        if (users.size() > maxInMemoryRecords && !accountsFilename.empty())
+        {
+            static const char *orderNames[] = {"name", "type", "credit"};
+            std::string sortedFilename = accountsFilename + ".by" + orderNames[order];
+            if (AccountFileSorter::sort(accountsFilename, sortedFilename, order, maxInMemoryRecords))
+            {
+                std::unique_ptr<SortedAccountsFile> view(new SortedAccountsFile(order, sortedFilename));
+                sortedFilenames.push_back(sortedFilename);
+                if (view->isOpen())
+                {
+                    views[order] = std::move(view);
+                    return *views[order];
+                }
+            }
+            std::cerr << "Error: Unable to sort the accounts file. Sorting in memory instead." << std::endl;
+        }
+
+        views[order].reset(new SortedAccountsInMemory(order, users));
+        return *views[order];
+    }
+
+private:
+    std::unique_ptr<SortedAccounts> views[AccountSortOrderCount];
+    std::vector<std::string> sortedFilenames;
+};
+
+// Options of a filtered, paged account listing, parsed from the arguments after "listusers"
+struct AccountQuery
+{
+    AccountSortOrder order = SortAccountsByName;
+    int type = -1;
+    int64_t minCreditCents = 0;
+    int64_t maxCreditCents = INT64_MAX;
+    size_t pageSize = 50;
+    size_t page = 1;
+    bool hasCursor = false;
+    AccountEntry cursor = {"", 0, 0};
+};
+
+// Function to encode the position of an account as a token that can be typed back on one line
+inline std::string encodeAccountCursor(const AccountEntry &entry)
+{
+    return encodePageCursor(entry.username + '\x1f' + std::to_string(entry.type) + '\x1f' + std::to_string(entry.creditCents));
+}
+
+// Function to decode a token made by encodeAccountCursor; returns false if it is malformed
+inline bool decodeAccountCursor(const std::string &cursor, AccountEntry &entry)
+{
+    std::string plain;
+    if (!decodePageCursor(cursor, plain))
+        return false;
+
+    size_t first = plain.find('\x1f');
+    size_t second = first == std::string::npos ? std::string::npos : plain.find('\x1f', first + 1);
+    size_t type;
+    size_t creditCents;
+    if (second == std::string::npos || !parseCount(plain.substr(first + 1, second - first - 1), 0, AccountManager, type) ||
+        !parseCount(plain.substr(second + 1), 0, 999999999, creditCents))
+        return false;
+
+    entry.username = plain.substr(0, first);
+    entry.type = static_cast<int>(type);
+    entry.creditCents = static_cast<int64_t>(creditCents);
+    return true;
+}
+
+// Function to parse "sort=name|type|credit type=<code> min=<credit> max=<credit> limit=<n> page=<n> after=<cursor>"
+// Returns an error message, or "" if every argument is valid
+inline std::string parseAccountQuery(const std::string &arguments, AccountQuery &query)
+{
+    std::istringstream argumentStream(arguments);
+    std::string argument;
+    while (argumentStream >> argument)
+    {
+        size_t equals = argument.find('=');
+        std::string name = argument.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+        if (value.empty())
+            return "Missing value for " + name;
+
+        if (name == "sort")
+        {
+            if (value == "name")
+                query.order = SortAccountsByName;
+            else if (value == "type")
+                query.order = SortAccountsByType;
+            else if (value == "credit")
+                query.order = SortAccountsByCredit;
+            else
+                return "Unknown sort order " + value;
+        }
+        else if (name == "type")
+        {
+            query.type = getUserTypeFromCode(value);
+            if (query.type == -1)
+                return "Unknown user type " + value;
+        }
+        else if (name == "min" || name == "max")
+        {
+            if (!parseDecimalCents(value, name == "min" ? query.minCreditCents : query.maxCreditCents))
+                return "Invalid credit " + value;
+        }
+        else if (name == "limit" || name == "page")
+        {
+            if (!parseCount(value, 1, name == "limit" ? 10000 : 100000000, name == "limit" ? query.pageSize : query.page))
+                return "Invalid " + name + " " + value;
+        }
+        else if (name == "after")
+        {
+            if (!decodeAccountCursor(value, query.cursor))
+                return "Invalid cursor " + value;
+            query.hasCursor = true;
+        }
+        else
+        {
+            return "Unknown listusers option " + name;
+        }
+    }
+    return "";
+}
+
+#endif
@@ -27,6 +27,8 @@ public:
             std::cout << "Enter username: ";
             std::cin >> username;
 
+            std::lock_guard<std::mutex> lock(sharedData.getMutex());
+
             // Iterate through the vector of users to find a match
             for (const User &user : users)
             {
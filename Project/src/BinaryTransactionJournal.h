@@ -0,0 +1,207 @@
+#ifndef BINARY_TRANSACTION_JOURNAL_H
+#define BINARY_TRANSACTION_JOURNAL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "MappedFile.h"
+
+// Function to compute the CRC32C (Castagnoli) checksum of a buffer
+inline uint32_t crc32c(const char *data, size_t length)
+{
+    static const std::vector<uint32_t> table = []
+    {
+        std::vector<uint32_t> entries(256);
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++)
+        crc = (crc >> 8) ^ table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF];
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// One transaction as the binary journal holds it: the names at full length, in the order the
+// daily transaction file lists them, and the amount in integer cents
+struct JournalRecord
+{
+    int code = 0;
+    std::vector<std::string> fields;
+    int64_t cents = 0;
+};
+
+// Binary counterpart of the daily transaction file ("<daily transaction file>.bin"), written with --binary-journal
+class BinaryTransactionJournal
+{
+public:
+    ~BinaryTransactionJournal()
+    {
+        if (journalFd >= 0)
+            ::close(journalFd);
+    }
+
+    // Function to open the journal for appending, numbering on from the last valid frame in it
+    bool open(const std::string &filename)
+    {
+        uint64_t validLength = 0;
+        bool corrupt = false;
+        if (!scan(filename, validLength, corrupt))
+        {
+            std::cerr << "Error: " << filename << " is not a binary transaction journal." << std::endl;
+            return false;
+        }
+        if (corrupt)
+        {
+            std::cerr << "Error: " << filename << " has a corrupt frame at byte " << validLength
+                      << " followed by more frames. The binary journal is not written until it is repaired or moved aside." << std::endl;
+            return false;
+        }
+
+        journalFd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (journalFd < 0)
+        {
+            std::cerr << "Error: Unable to open the binary transaction journal " << filename << "." << std::endl;
+            return false;
+        }
+
+        off_t fileLength = ::lseek(journalFd, 0, SEEK_END);
+        if (fileLength > static_cast<off_t>(validLength))
+        {
+            std::cerr << "Error: Dropping a torn frame at the end of " << filename << "." << std::endl;
+            if (::ftruncate(journalFd, static_cast<off_t>(validLength)) != 0)
+            {
+                std::cerr << "Error: Unable to truncate " << filename << "." << std::endl;
+                ::close(journalFd);
+                journalFd = -1;
+                return false;
+            }
+        }
+
+        if (validLength == 0)
+        {
+            pending.assign(header, sizeof(header));
+            pending.append(versionBytes, sizeof(versionBytes));
+        }
+        return true;
+    }
+
+    bool isEnabled() const
+    {
+        return journalFd >= 0;
+    }
+
+    // Function to frame a record with the next sequence number, held until write()
+    void add(const JournalRecord &record)
+    {
+        if (!isEnabled())
+            return;
+
+        std::string payload;
+        appendInteger(payload, nextSequence++, 8);
+        appendInteger(payload, static_cast<uint64_t>(record.code), 1);
+        appendInteger(payload, record.fields.size(), 1);
+        for (const std::string &field : record.fields)
+        {
+            size_t length = std::min<size_t>(field.length(), 0xFFFF);
+            appendInteger(payload, length, 2);
+            payload.append(field, 0, length);
+        }
+        appendInteger(payload, static_cast<uint64_t>(record.cents), 8);
+
+        appendInteger(pending, payload.length(), 4);
+        appendInteger(pending, crc32c(payload.data(), payload.length()), 4);
+        pending.append(payload);
+    }
+
+    // Function to append the frames added since the last write in one write
+    void write()
+    {
+        size_t written = 0;
+        while (isEnabled() && written < pending.size())
+        {
+            ssize_t result = ::write(journalFd, pending.data() + written, pending.size() - written);
+            if (result <= 0)
+            {
+                std::cerr << "Error: Unable to write the binary transaction journal." << std::endl;
+                break;
+            }
+            written += static_cast<size_t>(result);
+        }
+        pending.clear();
+    }
+
+private:
+    int journalFd = -1;
+    uint64_t nextSequence = 1;
+
+    // Frames (and for a new journal, the header) not yet written
+    std::string pending;
+
+    static constexpr char header[4] = {'S', 'D', 'T', 'J'};
+    static constexpr char versionBytes[4] = {1, 0, 0, 0};
+    static constexpr size_t headerLength = 8;
+
+    static void appendInteger(std::string &out, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+
+    static uint64_t readInteger(const char *in, int bytes)
+    {
+        uint64_t value = 0;
+        for (int i = bytes - 1; i >= 0; i--)
+            value = (value << 8) | static_cast<unsigned char>(in[i]);
+        return value;
+    }
+
+    // Function to find the length of the journal up to its last valid frame and the sequence number
+    // after it, and whether what follows is corruption rather than a torn last frame; returns false
+    // if the file exists but is not a journal
+    bool scan(const std::string &filename, uint64_t &validLength, bool &corrupt)
+    {
+        MappedFile journal(filename);
+        if (!journal.isOpen() || journal.size() == 0)
+            return true;
+        if (journal.size() < headerLength || std::memcmp(journal.data(), header, sizeof(header)) != 0 ||
+            std::memcmp(journal.data() + sizeof(header), versionBytes, sizeof(versionBytes)) != 0)
+            return false;
+
+        uint64_t offset = headerLength;
+        while (journal.size() - offset >= 8)
+        {
+            const char *frame = journal.data() + offset;
+            uint64_t payloadLength = readInteger(frame, 4);
+
+            // A frame running past the end of the file is the torn last write
+            if (payloadLength > journal.size() - offset - 8)
+                break;
+
+            // A bad frame is torn only if it is the last one
+            if (payloadLength < 18 || readInteger(frame + 4, 4) != crc32c(frame + 8, payloadLength))
+            {
+                corrupt = offset + 8 + payloadLength < journal.size();
+                break;
+            }
+
+            nextSequence = readInteger(frame + 8, 8) + 1;
+            offset += 8 + payloadLength;
+        }
+        validLength = offset;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,339 @@
+#ifndef CHANGE_FEED_H
+#define CHANGE_FEED_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Game.h"
+#include "GameUpdater.h"
+#include "MappedFile.h"
+#include "User.h"
+#include "UserUpdater.h"
+
+// Kind of record a change event is about
+enum ChangeEntity
+{
+    AccountEntity,   // Accounts file record, keyed by username
+    ListingEntity,   // Available games file record, keyed by seller/game
+    OwnershipEntity, // Games collection file record, keyed by owner/game
+    ChangeEntityCount
+};
+
+const char *const changeEntityNames[ChangeEntityCount] = {"account", "listing", "ownership"};
+
+// One change to the master state, with the record before and after it as the master files
+// would hold it; an empty image means the record did not exist on that side
+struct ChangeEvent
+{
+    uint64_t sequence = 0;
+    ChangeEntity entity = AccountEntity;
+    std::string key;
+    std::string before;
+    std::string after;
+
+    // For a listing insert: made with sell this run, so not buyable until the next start
+    bool pending = false;
+
+    const char *getOperation() const
+    {
+        return before.empty() ? "insert" : after.empty() ? "delete" : "update";
+    }
+};
+
+// Function to format an event as one change log line (without the newline)
+// Format: <sequence> TAB <entity> TAB <insert|update|delete> TAB <key> TAB <before> TAB <after> [TAB pending]
+inline std::string formatChangeEvent(const ChangeEvent &event)
+{
+    return std::to_string(event.sequence) + '\t' + changeEntityNames[event.entity] + '\t' + event.getOperation() + '\t' +
+           event.key + '\t' + event.before + '\t' + event.after + (event.pending ? "\tpending" : "");
+}
+
+// Function to parse a change log line; returns false if it is malformed
+inline bool parseChangeEvent(const std::string &line, ChangeEvent &event)
+{
+    std::vector<std::string> fields;
+    std::istringstream lineStream(line);
+    std::string field;
+    while (std::getline(lineStream, field, '\t'))
+        fields.push_back(field);
+    if (!line.empty() && line.back() == '\t')
+        fields.push_back("");
+    if ((fields.size() != 6 && (fields.size() != 7 || fields[6] != "pending")) || fields[0].empty() || fields[0].find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+    int entity = 0;
+    while (entity < ChangeEntityCount && fields[1] != changeEntityNames[entity])
+        entity++;
+    if (entity == ChangeEntityCount)
+        return false;
+
+    event.sequence = std::stoull(fields[0]);
+    event.entity = static_cast<ChangeEntity>(entity);
+    event.key = fields[3];
+    event.before = fields[4];
+    event.after = fields[5];
+    event.pending = fields.size() == 7;
+    return fields[2] == event.getOperation();
+}
+
+// Function to call handleEvent(event, endOffset) for each complete event of the change log
+// from a byte offset, where endOffset is where the next line starts; returns the offset after the last
+template <typename Handler>
+uint64_t readChangeLog(const std::string &logFilename, uint64_t offset, Handler handleEvent)
+{
+    MappedFile log(logFilename);
+    while (offset < log.size())
+    {
+        const char *start = log.data() + offset;
+        const void *newline = std::memchr(start, '\n', log.size() - offset);
+        if (newline == nullptr)
+            break;
+
+        uint64_t length = static_cast<const char *>(newline) - start;
+        ChangeEvent event;
+        if (parseChangeEvent(std::string(start, length), event))
+            handleEvent(event, offset + length + 1);
+        offset += length + 1;
+    }
+    return offset;
+}
+
+// Change data capture log of the accounts, listings and ownership records ("<accounts file>.changes")
+class ChangeFeed
+{
+public:
+    ~ChangeFeed()
+    {
+        if (logFd >= 0)
+            ::close(logFd);
+    }
+
+    // Function to start logging changes to the given file, numbering on from the events already in it
+    // or from lastSequence (the last event a promoted replica applied), whichever is later
+    bool open(const std::string &filename, uint64_t lastSequence = 0)
+    {
+        logFd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (logFd < 0)
+        {
+            std::cerr << "Error: Unable to open the change log " << filename << "." << std::endl;
+            return false;
+        }
+
+        logFilename = filename;
+        nextSequence = lastSequence + 1;
+        readChangeLog(logFilename, 0, [this](const ChangeEvent &event, uint64_t)
+                      { nextSequence = std::max(nextSequence, event.sequence + 1); });
+        return true;
+    }
+
+    bool isEnabled() const
+    {
+        return logFd >= 0;
+    }
+
+    const std::string &getLogFilename() const
+    {
+        return logFilename;
+    }
+
+    // Function to get the sequence number of the last event published
+    uint64_t getLastSequence() const
+    {
+        return nextSequence - 1;
+    }
+
+    // Function to set what to call once new events are in the log
+    void setListener(const std::function<void()> &listener)
+    {
+        onPublished = listener;
+    }
+
+    // Functions to report changes; a null before or after means the record was created or removed
+    void accountChanged(const User *before, const User *after)
+    {
+        if (!isEnabled())
+            return;
+        const User *user = after != nullptr ? after : before;
+        add(AccountEntity, user->getUsername(), before != nullptr ? UserUpdater::formatUser(*before) : "",
+            after != nullptr ? UserUpdater::formatUser(*after) : "");
+    }
+
+    // A pending listing is one made with sell this run, which is not buyable until the next start
+    void listingChanged(const Game *before, const Game *after, bool pendingListing = false)
+    {
+        if (!isEnabled())
+            return;
+        const Game *game = after != nullptr ? after : before;
+        add(ListingEntity, game->getSellerName() + '/' + game->getGameName(), before != nullptr ? GameUpdater::formatAvailableGame(*before) : "",
+            after != nullptr ? GameUpdater::formatAvailableGame(*after) : "", before == nullptr && pendingListing);
+    }
+
+    void ownershipChanged(const std::string &gameName, const std::string &ownerUsername, bool owned)
+    {
+        if (!isEnabled())
+            return;
+        std::string record = GameUpdater::formatCollectionEntry(gameName, ownerUsername);
+        add(OwnershipEntity, ownerUsername + '/' + gameName, owned ? "" : record, owned ? record : "");
+    }
+
+    // Function to drop the reported events of a transaction that was not saved
+    void discard()
+    {
+        pending.clear();
+    }
+
+    // Function to number the reported events and append them to the log in one write
+    void publish()
+    {
+        if (pending.empty())
+            return;
+
+        std::string lines;
+        for (ChangeEvent &event : pending)
+        {
+            event.sequence = nextSequence++;
+            lines.append(formatChangeEvent(event)).push_back('\n');
+        }
+        pending.clear();
+
+        size_t written = 0;
+        while (written < lines.size())
+        {
+            ssize_t result = ::write(logFd, lines.data() + written, lines.size() - written);
+            if (result <= 0)
+            {
+                std::cerr << "Error: Unable to write the change log." << std::endl;
+                return;
+            }
+            written += static_cast<size_t>(result);
+        }
+
+        if (onPublished)
+            onPublished();
+    }
+
+private:
+    int logFd = -1;
+    std::string logFilename;
+    uint64_t nextSequence = 1;
+
+    // Events reported by the transaction in progress
+    std::vector<ChangeEvent> pending;
+
+    std::function<void()> onPublished;
+
+    void add(ChangeEntity entity, const std::string &key, const std::string &before, const std::string &after, bool pendingListing = false)
+    {
+        ChangeEvent event;
+        event.entity = entity;
+        event.key = key;
+        event.before = before;
+        event.after = after;
+        event.pending = pendingListing;
+        pending.push_back(event);
+    }
+};
+
+// Sequence number each named consumer has processed the change log up to, kept in
+// "<change log>.offsets" as "<consumer> <sequence>" lines and replaced in one rename
+class ChangeConsumerOffsets
+{
+public:
+    ChangeConsumerOffsets(const std::string &logFilename)
+        : offsetsFilename(logFilename + ".offsets")
+    {
+        std::ifstream offsetsFile(offsetsFilename);
+        std::string consumer;
+        uint64_t sequence;
+        while (offsetsFile >> consumer >> sequence)
+            offsets[consumer] = sequence;
+    }
+
+    // Function to get the last sequence number a consumer committed, 0 if it never did
+    uint64_t get(const std::string &consumer) const
+    {
+        auto found = offsets.find(consumer);
+        return found == offsets.end() ? 0 : found->second;
+    }
+
+    // Function to record that a consumer has processed every event up to a sequence number
+    bool commit(const std::string &consumer, uint64_t sequence)
+    {
+        offsets[consumer] = sequence;
+
+        std::string tempFilename = offsetsFilename + ".tmp";
+        std::ofstream offsetsFile(tempFilename, std::ios::trunc);
+        for (const auto &offset : offsets)
+            offsetsFile << offset.first << ' ' << offset.second << '\n';
+        offsetsFile.close();
+
+        if (offsetsFile.fail() || std::rename(tempFilename.c_str(), offsetsFilename.c_str()) != 0)
+        {
+            std::cerr << "Error: Unable to save the change consumer offsets." << std::endl;
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string offsetsFilename;
+    std::map<std::string, uint64_t> offsets;
+};
+
+// Reader of the change log for consumers that follow the file instead of the socket
+class ChangeConsumer
+{
+public:
+    // Constructor that starts after the last event the named consumer committed
+    ChangeConsumer(const std::string &logFilename, const std::string &name)
+        : logFilename(logFilename), name(name), offsets(logFilename)
+    {
+        committed = offsets.get(name);
+    }
+
+    // Function to get the events after the last one returned, at most maxEvents of them
+    std::vector<ChangeEvent> poll(size_t maxEvents)
+    {
+        std::vector<ChangeEvent> events;
+        uint64_t after = std::max(committed, delivered);
+        readChangeLog(logFilename, logOffset, [&](const ChangeEvent &event, uint64_t endOffset)
+                      {
+                          if (events.size() >= maxEvents)
+                              return;
+                          logOffset = endOffset;
+                          if (event.sequence > after)
+                              events.push_back(event);
+                      });
+        if (!events.empty())
+            delivered = events.back().sequence;
+        return events;
+    }
+
+    // Function to record that every event up to a sequence number is processed, so a restart resumes after it
+    bool commit(uint64_t sequence)
+    {
+        committed = sequence;
+        return offsets.commit(name, sequence);
+    }
+
+private:
+    std::string logFilename;
+    std::string name;
+    ChangeConsumerOffsets offsets;
+    uint64_t committed = 0;
+    uint64_t delivered = 0;
+    uint64_t logOffset = 0;
+};
+
+#endif
@@ -0,0 +1,305 @@
+#ifndef CHANGE_FEED_SERVER_H
+#define CHANGE_FEED_SERVER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ChangeFeed.h"
+
+// Serves the change log to consumers and replicas over a Unix domain socket ("<change log>.sock")
+class ChangeFeedServer
+{
+public:
+    ChangeFeedServer(ChangeFeed &changeFeed) : changeFeed(changeFeed) {}
+
+    // Destructor that stops the server thread
+    ~ChangeFeedServer()
+    {
+        stop();
+    }
+
+    // Function to set what builds the snapshot a replica starts from; it returns the snapshot
+    // lines and sets the sequence number of the last event they include
+    void setSnapshotSource(const std::function<std::string(uint64_t &)> &source)
+    {
+        snapshotSource = source;
+    }
+
+    ChangeFeedServer(const ChangeFeedServer &) = delete;
+    ChangeFeedServer &operator=(const ChangeFeedServer &) = delete;
+
+    // Function to start serving; the feed must already be open
+    bool start()
+    {
+        socketPath = changeFeed.getLogFilename() + ".sock";
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.length() >= sizeof(address.sun_path))
+        {
+            std::cerr << "Error: The change feed socket path " << socketPath << " is too long." << std::endl;
+            return false;
+        }
+        std::strcpy(address.sun_path, socketPath.c_str());
+
+        // A socket left by a run that did not stop cleanly would keep bind from succeeding
+        ::unlink(socketPath.c_str());
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0 || ::bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            ::listen(listenFd, 16) != 0 || ::pipe2(wakeFds, O_NONBLOCK | O_CLOEXEC) != 0)
+        {
+            std::cerr << "Error: Unable to serve the change feed on " << socketPath << "." << std::endl;
+            closeAll();
+            return false;
+        }
+
+        offsets.reset(new ChangeConsumerOffsets(changeFeed.getLogFilename()));
+        changeFeed.setListener([this]()
+                               { wake(); });
+        stopping = false;
+        worker = std::thread(&ChangeFeedServer::run, this);
+        return true;
+    }
+
+    // Function to stop the server thread and disconnect every consumer
+    void stop()
+    {
+        if (worker.joinable())
+        {
+            stopping = true;
+            wake();
+            worker.join();
+            changeFeed.setListener(nullptr);
+        }
+        closeAll();
+    }
+
+private:
+    // A connected consumer
+    struct Consumer
+    {
+        int fd;
+        std::string name;       // Empty until it sends CONSUME
+        bool streaming = false; // Whether it has sent CONSUME or REPLICATE
+        std::string input;
+        std::string output;
+        uint64_t logOffset = 0; // Where in the log the next event to send starts
+        uint64_t after = 0;     // Events up to this sequence number are not sent
+    };
+
+    ChangeFeed &changeFeed;
+    std::function<std::string(uint64_t &)> snapshotSource;
+    std::unique_ptr<ChangeConsumerOffsets> offsets;
+    std::string socketPath;
+    int listenFd = -1;
+    int wakeFds[2] = {-1, -1};
+    std::list<Consumer> consumers;
+
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+
+    // Most event bytes read ahead for one consumer before it has taken them
+    static constexpr size_t maxBufferedBytes = 1 << 20;
+
+    void wake()
+    {
+        if (wakeFds[1] >= 0)
+        {
+            char byte = 0;
+            ssize_t ignored = ::write(wakeFds[1], &byte, 1); // A full pipe already has a wakeup pending
+            (void)ignored;
+        }
+    }
+
+    void closeAll()
+    {
+        for (Consumer &consumer : consumers)
+            ::close(consumer.fd);
+        consumers.clear();
+        for (int *fd : {&listenFd, &wakeFds[0], &wakeFds[1]})
+        {
+            if (*fd >= 0)
+                ::close(*fd);
+            *fd = -1;
+        }
+        if (!socketPath.empty())
+            ::unlink(socketPath.c_str());
+    }
+
+    void run()
+    {
+        while (!stopping)
+        {
+            std::vector<pollfd> fds;
+            fds.push_back(pollfd{wakeFds[0], POLLIN, 0});
+            fds.push_back(pollfd{listenFd, POLLIN, 0});
+            for (const Consumer &consumer : consumers)
+                fds.push_back(pollfd{consumer.fd, static_cast<short>(POLLIN | (consumer.output.empty() ? 0 : POLLOUT)), 0});
+
+            if (::poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+            {
+                std::cerr << "Error: The change feed server stopped: " << std::strerror(errno) << std::endl;
+                return;
+            }
+
+            if (fds[0].revents != 0)
+            {
+                char drained[64];
+                while (::read(wakeFds[0], drained, sizeof(drained)) > 0)
+                {
+                }
+            }
+
+            if (fds[1].revents != 0)
+                acceptConsumers();
+
+            size_t index = 2;
+            for (auto consumer = consumers.begin(); consumer != consumers.end(); index++)
+            {
+                bool open = true;
+                short events = index < fds.size() ? fds[index].revents : 0;
+                if (events & (POLLIN | POLLHUP | POLLERR))
+                    open = receive(*consumer);
+                // Keep reading ahead while the socket takes everything, so a catch-up does not wait for the next event
+                bool more = open && consumer->streaming;
+                while (open)
+                {
+                    more = more && fill(*consumer);
+                    open = send(*consumer);
+                    if (!more || !consumer->output.empty())
+                        break;
+                }
+
+                if (open)
+                {
+                    ++consumer;
+                }
+                else
+                {
+                    ::close(consumer->fd);
+                    consumer = consumers.erase(consumer);
+                }
+            }
+        }
+    }
+
+    void acceptConsumers()
+    {
+        int fd;
+        while ((fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+        {
+            Consumer consumer;
+            consumer.fd = fd;
+            consumers.push_back(consumer);
+        }
+    }
+
+    // Function to read and run the consumer's commands; returns false once it has disconnected
+    bool receive(Consumer &consumer)
+    {
+        char buffer[4096];
+        ssize_t length;
+        while ((length = ::read(consumer.fd, buffer, sizeof(buffer))) > 0)
+            consumer.input.append(buffer, static_cast<size_t>(length));
+        if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+            return false;
+
+        size_t newline;
+        while ((newline = consumer.input.find('\n')) != std::string::npos)
+        {
+            std::string line = consumer.input.substr(0, newline);
+            consumer.input.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            runCommand(consumer, line);
+        }
+        return true;
+    }
+
+    void runCommand(Consumer &consumer, const std::string &line)
+    {
+        std::istringstream fields(line);
+        std::string command;
+        std::string argument;
+        fields >> command >> argument;
+
+        bool isSequence = !argument.empty() && argument.length() <= 19 && argument.find_first_not_of("0123456789") == std::string::npos;
+        if (command == "CONSUME" && !argument.empty() && !consumer.streaming)
+        {
+            consumer.name = argument;
+            consumer.after = offsets->get(argument);
+            consumer.logOffset = 0;
+            consumer.streaming = true;
+        }
+        else if (command == "REPLICATE" && argument.empty() && !consumer.streaming && snapshotSource)
+        {
+            uint64_t sequence = 0;
+            std::string snapshot = snapshotSource(sequence);
+            consumer.output += "SNAPSHOT " + std::to_string(sequence) + '\n' + snapshot + "END\n";
+            consumer.after = sequence;
+            consumer.logOffset = 0;
+            consumer.streaming = true;
+        }
+        else if (command == "COMMIT" && !consumer.name.empty() && isSequence)
+        {
+            if (!offsets->commit(consumer.name, std::stoull(argument)))
+                consumer.output += "ERR unable to save the offset\n";
+        }
+        else
+        {
+            consumer.output += "ERR expected CONSUME <name> or REPLICATE once, then COMMIT <sequence>\n";
+        }
+    }
+
+    // Function to queue the events the consumer has not been sent yet, up to the buffer limit
+    // Returns true if the limit left events unread
+    bool fill(Consumer &consumer)
+    {
+        bool full = false;
+        readChangeLog(changeFeed.getLogFilename(), consumer.logOffset, [&](const ChangeEvent &event, uint64_t endOffset)
+                      {
+                          if (full || consumer.output.size() >= maxBufferedBytes)
+                          {
+                              full = true;
+                              return;
+                          }
+                          if (event.sequence > consumer.after)
+                          {
+                              consumer.output.append(formatChangeEvent(event)).push_back('\n');
+                              consumer.after = event.sequence;
+                          }
+                          consumer.logOffset = endOffset;
+                      });
+        return full;
+    }
+
+    // Function to send what is queued for the consumer; returns false once it has disconnected
+    bool send(Consumer &consumer)
+    {
+        while (!consumer.output.empty())
+        {
+            ssize_t sent = ::send(consumer.fd, consumer.output.data(), consumer.output.size(), MSG_NOSIGNAL);
+            if (sent < 0)
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            consumer.output.erase(0, static_cast<size_t>(sent));
+        }
+        return true;
+    }
+};
+
+#endif
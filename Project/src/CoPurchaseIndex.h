@@ -0,0 +1,295 @@
+#ifndef CO_PURCHASE_INDEX_H
+#define CO_PURCHASE_INDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "FileReader.h"
+#include "MappedFile.h"
+
+// A game owned alongside another, and by how many owners
+struct CoPurchase
+{
+    std::string gameName;
+    uint32_t coOwners;
+};
+
+// Counts of the users who own each pair of games, for "users who own X also own" recommendations
+class CoPurchaseIndex
+{
+public:
+    // Constructor that builds the matrix from the given games collection file
+    CoPurchaseIndex(const std::string &gamesCollectionFilename)
+    {
+        build(gamesCollectionFilename);
+    }
+
+    // Function to get the games most often owned together with the given one, most co-owners first
+    std::vector<CoPurchase> getAlsoOwned(const std::string &gameName, size_t count) const
+    {
+        std::vector<CoPurchase> alsoOwned;
+        auto found = gameIds.find(gameName);
+        if (found == gameIds.end())
+            return alsoOwned;
+
+        std::vector<std::pair<uint32_t, uint32_t>> row = getRow(found->second);
+        size_t shown = std::min(count, row.size());
+        std::partial_sort(row.begin(), row.begin() + shown, row.end(),
+                          [this](const std::pair<uint32_t, uint32_t> &left, const std::pair<uint32_t, uint32_t> &right)
+                          {
+                              return left.second != right.second ? left.second > right.second : gameNames[left.first] < gameNames[right.first];
+                          });
+        for (size_t i = 0; i < shown; i++)
+            alsoOwned.push_back(CoPurchase{gameNames[row[i].first], row[i].second});
+        return alsoOwned;
+    }
+
+    // Function to count a user's newly bought games against each other and the games they already owned
+    // ownedGameNames is the collection after the buy and includes the new games
+    void recordPurchases(const std::vector<std::string> &boughtGameNames, const std::vector<std::string> &ownedGameNames)
+    {
+        std::vector<uint32_t> previous;
+        for (const std::string &gameName : ownedGameNames)
+        {
+            if (std::find(boughtGameNames.begin(), boughtGameNames.end(), gameName) == boughtGameNames.end())
+                previous.push_back(getOrAddGameId(gameName));
+        }
+
+        for (const std::string &gameName : boughtGameNames)
+        {
+            uint32_t bought = getOrAddGameId(gameName);
+            for (uint32_t owned : previous)
+            {
+                if (owned == bought)
+                    continue;
+                overlay[bought][owned]++;
+                overlay[owned][bought]++;
+                overlayEntries += 2;
+            }
+            previous.push_back(bought);
+        }
+
+        if (overlayEntries > std::max<size_t>(minOverlayEntries, columns.size() / 8))
+            foldOverlay();
+    }
+
+private:
+    // Overlay size below which it is never folded into the rows
+    static constexpr size_t minOverlayEntries = 4096;
+
+    // Owners each build thread should have at least, so small files are counted on one thread
+    static constexpr size_t minOwnersPerThread = 1024;
+
+    // Game names by id, and ids by name
+    std::vector<std::string> gameNames;
+    std::unordered_map<std::string, uint32_t> gameIds;
+
+    // Compressed sparse rows: row r is columns/counts [rowOffsets[r], rowOffsets[r + 1])
+    // Games added after the build have no row yet
+    std::vector<uint64_t> rowOffsets{0};
+    std::vector<uint32_t> columns;
+    std::vector<uint32_t> counts;
+
+    // Co-owner counts added since the rows were built, by row then column
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> overlay;
+    size_t overlayEntries = 0;
+
+    uint32_t getOrAddGameId(const std::string &gameName)
+    {
+        auto found = gameIds.find(gameName);
+        if (found != gameIds.end())
+            return found->second;
+
+        uint32_t id = static_cast<uint32_t>(gameNames.size());
+        gameNames.push_back(gameName);
+        gameIds.emplace(gameName, id);
+        return id;
+    }
+
+    // Function to get one row of the matrix with the overlay applied, as (column, count) pairs
+    std::vector<std::pair<uint32_t, uint32_t>> getRow(uint32_t row) const
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> entries;
+        if (row + 1 < rowOffsets.size())
+        {
+            for (uint64_t i = rowOffsets[row]; i < rowOffsets[row + 1]; i++)
+                entries.push_back(std::make_pair(columns[i], counts[i]));
+        }
+
+        auto added = overlay.find(row);
+        if (added == overlay.end())
+            return entries;
+
+        size_t built = entries.size();
+        for (const auto &entry : added->second)
+        {
+            auto existing = std::lower_bound(entries.begin(), entries.begin() + built, std::make_pair(entry.first, uint32_t(0)));
+            if (existing != entries.begin() + built && existing->first == entry.first)
+                existing->second += entry.second;
+            else
+                entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    // Function to rebuild the rows with the overlay folded in
+    void foldOverlay()
+    {
+        std::vector<uint64_t> foldedOffsets{0};
+        std::vector<uint32_t> foldedColumns;
+        std::vector<uint32_t> foldedCounts;
+        for (uint32_t row = 0; row < gameNames.size(); row++)
+        {
+            std::vector<std::pair<uint32_t, uint32_t>> entries = getRow(row);
+            std::sort(entries.begin(), entries.end());
+            for (const auto &entry : entries)
+            {
+                foldedColumns.push_back(entry.first);
+                foldedCounts.push_back(entry.second);
+            }
+            foldedOffsets.push_back(foldedColumns.size());
+        }
+
+        rowOffsets.swap(foldedOffsets);
+        columns.swap(foldedColumns);
+        counts.swap(foldedCounts);
+        overlay.clear();
+        overlayEntries = 0;
+    }
+
+    // Function to count the pairs in a share of the owners' collections
+    // Returns (row << 32 | column, count) sorted by key
+    static std::vector<std::pair<uint64_t, uint32_t>> countPairs(const std::vector<std::vector<uint32_t>> &collections, size_t begin, size_t end)
+    {
+        std::vector<uint64_t> pairs;
+        for (size_t owner = begin; owner < end; owner++)
+        {
+            const std::vector<uint32_t> &owned = collections[owner];
+            for (uint32_t row : owned)
+            {
+                for (uint32_t column : owned)
+                {
+                    if (row != column)
+                        pairs.push_back(uint64_t(row) << 32 | column);
+                }
+            }
+        }
+        std::sort(pairs.begin(), pairs.end());
+
+        std::vector<std::pair<uint64_t, uint32_t>> counted;
+        for (uint64_t pair : pairs)
+        {
+            if (!counted.empty() && counted.back().first == pair)
+                counted.back().second++;
+            else
+                counted.push_back(std::make_pair(pair, uint32_t(1)));
+        }
+        return counted;
+    }
+
+    // Function to read the games collection file and build the rows from it
+    void build(const std::string &gamesCollectionFilename)
+    {
+        MappedFile file(gamesCollectionFilename);
+        if (!file.isOpen())
+        {
+            std::cerr << "Error: Unable to read the games collection file for recommendations." << std::endl;
+            return;
+        }
+
+        // Group the game ids by owner
+        std::unordered_map<std::string, size_t> ownerSlots;
+        std::vector<std::vector<uint32_t>> collections;
+        const char *data = file.data();
+        size_t offset = 0;
+        while (offset < file.size())
+        {
+            const void *newline = std::memchr(data + offset, '\n', file.size() - offset);
+            size_t lineEnd = newline == nullptr ? file.size() : static_cast<const char *>(newline) - data;
+            std::string line(data + offset, lineEnd - offset);
+            offset = lineEnd + 1;
+
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.length() != 42)
+                continue;
+
+            std::string gameName;
+            std::string ownerUsername;
+            FileReader::parseCollectionRecord(line, gameName, ownerUsername);
+            if (gameName == "END" && ownerUsername.empty())
+                break;
+            if (gameName.empty() || ownerUsername.empty())
+                continue; // Deleted in place
+
+            auto slot = ownerSlots.emplace(ownerUsername, collections.size());
+            if (slot.second)
+                collections.emplace_back();
+            collections[slot.first->second].push_back(getOrAddGameId(gameName));
+        }
+
+        for (std::vector<uint32_t> &owned : collections)
+        {
+            std::sort(owned.begin(), owned.end());
+            owned.erase(std::unique(owned.begin(), owned.end()), owned.end());
+        }
+
+        // Count the pairs of each share of owners on its own thread
+        size_t threadCount = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), collections.size() / minOwnersPerThread));
+        std::vector<std::vector<std::pair<uint64_t, uint32_t>>> shares(threadCount);
+        std::vector<std::thread> workers;
+        for (size_t share = 0; share < threadCount; share++)
+        {
+            size_t begin = collections.size() * share / threadCount;
+            size_t end = collections.size() * (share + 1) / threadCount;
+            workers.emplace_back([&collections, &shares, share, begin, end]()
+                                 { shares[share] = countPairs(collections, begin, end); });
+        }
+        for (std::thread &worker : workers)
+            worker.join();
+
+        // Merge the sorted shares into rows, adding up the counts of a pair found in several
+        typedef std::pair<uint64_t, size_t> Head; // (pair, share)
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        std::vector<size_t> positions(threadCount, 0);
+        for (size_t share = 0; share < threadCount; share++)
+        {
+            if (!shares[share].empty())
+                heads.push(Head(shares[share][0].first, share));
+        }
+
+        rowOffsets.assign(gameNames.size() + 1, 0);
+        uint64_t lastPair = UINT64_MAX;
+        while (!heads.empty())
+        {
+            Head head = heads.top();
+            heads.pop();
+            uint32_t count = shares[head.second][positions[head.second]].second;
+            if (++positions[head.second] < shares[head.second].size())
+                heads.push(Head(shares[head.second][positions[head.second]].first, head.second));
+
+            if (head.first == lastPair)
+            {
+                counts.back() += count;
+                continue;
+            }
+            lastPair = head.first;
+            columns.push_back(static_cast<uint32_t>(head.first));
+            counts.push_back(count);
+            rowOffsets[(head.first >> 32) + 1] = columns.size();
+        }
+
+        // Rows with no entries end where the row before them does
+        for (size_t row = 1; row < rowOffsets.size(); row++)
+            rowOffsets[row] = std::max(rowOffsets[row], rowOffsets[row - 1]);
+    }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef COLLECTION_LOADER_H
+#define COLLECTION_LOADER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "User.h"
+#include "FileReader.h"
+#include "RecordIndex.h"
+
+// Loads one user's games collection on demand by seeking to the records listed for them
+// in the owner index, instead of reading the whole games collection file up front
+class LazyCollectionLoader : public CollectionSource
+{
+public:
+    // Constructor that takes the games collection filename and the owner index over it
+    LazyCollectionLoader(const std::string &filename, const RecordIndex &collectionIndex)
+        : filename(filename), collectionIndex(collectionIndex) {}
+
+    // Function to read the names of the games owned by the given user
+    std::vector<std::string> loadCollection(const std::string &username) const override
+    {
+        std::vector<std::string> gameNames;
+
+        auto ownedGames = collectionIndex.find(username);
+        if (ownedGames == collectionIndex.end())
+            return gameNames;
+
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Error: Unable to open the games collection file for reading." << std::endl;
+            return gameNames;
+        }
+
+        std::string record(42, ' ');
+        for (std::streamoff offset : ownedGames->second)
+        {
+            file.seekg(offset);
+            if (!file.read(&record[0], record.length()))
+                break;
+
+            std::string gameName;
+            std::string ownerUsername;
+            FileReader::parseCollectionRecord(record, gameName, ownerUsername);
+
+            // Skip anything the index no longer describes correctly
+            if (ownerUsername == username)
+                gameNames.push_back(gameName);
+        }
+
+        return gameNames;
+    }
+
+private:
+    // Member variables holding the file and the index into it
+    std::string filename;
+    const RecordIndex &collectionIndex;
+};
+
+#endif
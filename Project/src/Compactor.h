@@ -0,0 +1,1187 @@
+#ifndef COMPACTOR_H
+#define COMPACTOR_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "SharedData.h"
+#include "FileReader.h"
+#include "UserUpdater.h"
+#include "GameUpdater.h"
+#include "RecordIndex.h"
+#include "FileHash.h"
+#include "MasterFile.h"
+#include "ShardRouter.h"
+
+// Records changes to the master files as appended delta journals and rewrites the master files from memory on a background thread
+class Compactor
+{
+public:
+    // Constructor that takes SharedData, the three master filenames and the router sharding two of them
+    Compactor(SharedData &sharedData, const std::string &accountsFilename,
+              const std::string &availableGamesFilename, const std::string &gamesCollectionFilename,
+              ShardRouter &shardRouter)
+        : sharedData(sharedData),
+          filenames{accountsFilename, availableGamesFilename, gamesCollectionFilename},
+          shardRouter(shardRouter),
+          intentFilename(accountsFilename + ".intent")
+    {
+        for (size_t shard = 0; shardRouter.isSharded() && shard < shardRouter.getShardCount(); shard++)
+        {
+            shards.emplace_back(new Shard());
+            shards.back()->index = shard;
+        }
+    }
+
+    // Destructor that stops the background thread and compacts anything still pending
+    ~Compactor()
+    {
+        stop();
+    }
+
+    // Function to replay journals from an interrupted run and start the background thread
+    // Must be called once the master files have been loaded into SharedData
+    void start()
+    {
+        recoverTransferIntent();
+        for (int file = 0; file < MasterFileCount; file++)
+        {
+            bool replayed = replayJournal(file, getJournalFilename(file) + ".compacting");
+            replayed = replayJournal(file, getJournalFilename(file)) || replayed;
+            dirty[file] = replayed;
+        }
+
+        // An interrupted sharded run left changes in its shard journals, on top of the master files
+        // the router rebuilt from its shards; fold them in and make the master files current again
+        if (shardRouter.wasInterrupted())
+        {
+            replayShardJournals();
+            std::lock_guard<std::mutex> dataLock(sharedData.getMutex());
+            rewriteMasterFiles();
+            retireInterruptedShards();
+        }
+
+        if (!shards.empty())
+        {
+            // The shards written next hold everything the master files' journals replayed; those
+            // journals go when the master files are rebuilt at stop
+            dirty[AccountsFile] = false;
+            dirty[GamesCollectionFile] = false;
+            std::lock_guard<std::mutex> dataLock(sharedData.getMutex());
+            openShards();
+        }
+
+        worker = std::thread(&Compactor::run, this);
+        wakeup.notify_all();
+    }
+
+    // Function to take over a promoted replica's state, rewriting every master file from it and starting the background thread
+    // Caller holds the SharedData mutex
+    void adoptState()
+    {
+        std::remove(intentFilename.c_str());
+        rewriteMasterFiles();
+        retireInterruptedShards();
+        if (!shards.empty())
+            openShards();
+
+        worker = std::thread(&Compactor::run, this);
+        wakeup.notify_all();
+    }
+
+    // Function to stop the background thread and synchronously compact every dirty file
+    void stop()
+    {
+        if (!worker.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        worker.join();
+
+        compact();
+        if (shardsOpen)
+            closeShards();
+    }
+
+    // Function to check whether every recorded delta has been folded into the master files
+    bool isClean()
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return !hasDirtyFile() && !shardsOpen &&
+               !compacting[AccountsFile] && !compacting[AvailableGamesFile] && !compacting[GamesCollectionFile];
+    }
+
+    // Function to check whether one master file has every recorded delta folded into it
+    bool isClean(int file)
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return !dirty[file] && !compacting[file] && (file == AvailableGamesFile || !shardsOpen);
+    }
+
+    // Function to get the content hash of the last version of a master file written by compaction
+    uint64_t getLastWrittenHash(int file)
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return lastWrittenHash[file];
+    }
+
+    // Function to rebuild every master file with pending deltas right away
+    void flush()
+    {
+        compact();
+        for (std::unique_ptr<Shard> &shard : shards)
+            compactShard(*shard);
+    }
+
+    // Function to start staging the deltas of one transaction as a transfer
+    void beginTransfer()
+    {
+        transferOpen = true;
+    }
+
+    // Function to check whether a transfer could not be made durable, so nothing more is written
+    bool hasFailed() const
+    {
+        return failed;
+    }
+
+    // Function to append the deltas staged since beginTransfer, through the intent record if they span journals,
+    // and sync every journal it touched; returns false if the transfer could not be made durable
+    bool commitTransfer()
+    {
+        if (!transferOpen)
+            return true;
+        transferOpen = false;
+
+        // Each journal the transfer touches, as its intent tag, and the lines for it
+        std::vector<std::pair<std::string, std::string>> targets;
+        for (int file = 0; file < MasterFileCount; file++)
+        {
+            if (!transferDeltas[file].empty())
+                targets.push_back(std::make_pair(std::string(1, journalTags[file]), joinLines(transferDeltas[file])));
+            transferDeltas[file].clear();
+        }
+        for (std::unique_ptr<Shard> &shard : shards)
+        {
+            if (!shard->transferLines.empty())
+                targets.push_back(std::make_pair("S" + std::to_string(shard->index), joinLines(shard->transferLines)));
+            shard->transferLines.clear();
+        }
+
+        bool spansJournals = targets.size() > 1;
+        if (spansJournals && !writeTransferIntent(targets))
+        {
+            std::cerr << "Error: Unable to write the transfer intent. The transaction was not saved; restart the program." << std::endl;
+            failed = true;
+            return false;
+        }
+
+        bool appended = true;
+        for (const auto &target : targets)
+            appended = appendToJournal(target.first, target.second) && appended;
+
+        // The transfer is saved, and the intent may go, only once every journal holds its lines on disk
+        for (const auto &target : targets)
+        {
+            std::string journalFilename = getTaggedJournalFilename(target.first);
+            appended = appended && syncFile(journalFilename) && syncDirectoryOf(journalFilename);
+        }
+        if (!appended)
+        {
+            if (spansJournals)
+                std::cerr << "Error: Unable to append the transfer to its journals. It will be completed on the next start; restart the program." << std::endl;
+            else
+                std::cerr << "Error: Unable to save the transfer to its journal; restart the program." << std::endl;
+            failed = true;
+            return false;
+        }
+
+        if (spansJournals)
+            std::remove(intentFilename.c_str());
+        return true;
+    }
+
+    // Functions to record deltas; callers hold the SharedData mutex and have already updated memory
+    void recordUserUpdate(const User &user)
+    {
+        appendDelta(AccountsFile, "+" + UserUpdater::formatUser(user));
+    }
+
+    void recordUserDeletion(const std::string &username)
+    {
+        appendDelta(AccountsFile, "-" + username);
+    }
+
+    // Functions to record a batch of changes with one journal write per master file
+    void recordUserUpdates(const std::vector<User> &users)
+    {
+        std::vector<std::string> deltas;
+        deltas.reserve(users.size());
+        for (const User &user : users)
+            deltas.push_back("+" + UserUpdater::formatUser(user));
+        appendDeltas(AccountsFile, deltas);
+    }
+
+    void recordOwnerships(const std::vector<std::string> &gameNames, const std::string &ownerUsername)
+    {
+        std::vector<std::string> deltas;
+        deltas.reserve(gameNames.size());
+        for (const std::string &gameName : gameNames)
+            deltas.push_back("+" + GameUpdater::formatCollectionEntry(gameName, ownerUsername));
+        appendDeltas(GamesCollectionFile, deltas);
+    }
+
+    void recordUserDeletions(const std::vector<std::string> &usernames)
+    {
+        appendDeltas(AccountsFile, prefixDeltas('-', usernames));
+    }
+
+    void recordListingsDeletions(const std::vector<std::string> &sellerUsernames)
+    {
+        appendDeltas(AvailableGamesFile, prefixDeltas('-', sellerUsernames));
+    }
+
+    void recordOwnershipDeletions(const std::vector<std::string> &ownerUsernames)
+    {
+        appendDeltas(GamesCollectionFile, prefixDeltas('-', ownerUsernames));
+    }
+
+    void recordListing(const Game &game)
+    {
+        appendDelta(AvailableGamesFile, "+" + GameUpdater::formatAvailableGame(game));
+    }
+
+    void recordListingsDeletion(const std::string &sellerUsername)
+    {
+        appendDelta(AvailableGamesFile, "-" + sellerUsername);
+    }
+
+    void recordOwnership(const std::string &gameName, const std::string &ownerUsername)
+    {
+        appendDelta(GamesCollectionFile, "+" + GameUpdater::formatCollectionEntry(gameName, ownerUsername));
+    }
+
+    void recordOwnershipDeletion(const std::string &ownerUsername)
+    {
+        appendDelta(GamesCollectionFile, "-" + ownerUsername);
+    }
+
+private:
+    // Reference to the shared data object
+    SharedData &sharedData;
+
+    // Master filenames, in MasterFile order
+    std::string filenames[MasterFileCount];
+
+    // Whether each master file has deltas not yet folded into it
+    bool dirty[MasterFileCount] = {false, false, false};
+
+    // Whether each master file is being rewritten by a compaction whose file is not yet swapped in,
+    // so it is not clean even though its deltas were taken
+    bool compacting[MasterFileCount] = {false, false, false};
+
+    // Content hash of each master file as compaction last wrote it, so watchers can skip our own writes
+    uint64_t lastWrittenHash[MasterFileCount] = {0, 0, 0};
+
+    // Background thread state
+    std::thread worker;
+    std::mutex stateMutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+
+    // Serializes compactions between the background thread and flush/stop
+    std::mutex compactionMutex;
+
+    // Counter used to give every temp file a unique name
+    unsigned long tempFileCounter = 0;
+
+    // Delay that lets a burst of deltas be folded into one compaction
+    static constexpr int compactionDelayMs = 200;
+
+    // Router deciding which shard a user's records belong to
+    ShardRouter &shardRouter;
+
+    // One shard of the accounts and games collection files, with its own journal and compaction thread
+    struct Shard
+    {
+        size_t index = 0;
+        bool dirty = false;
+        bool stopping = false;
+        std::thread worker;
+        std::mutex stateMutex;
+        std::condition_variable wakeup;
+        std::mutex compactionMutex;
+
+        // Journal lines of the transfer in progress
+        std::vector<std::string> transferLines;
+    };
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    // Whether the shards, not the master files, hold the latest accounts and collections
+    bool shardsOpen = false;
+
+    // Transfer state; only touched by transactions, under the SharedData mutex
+    bool transferOpen = false;
+
+    // Set when a transfer could not be made durable; from then on no file is written
+    std::atomic<bool> failed{false};
+    std::vector<std::string> transferDeltas[MasterFileCount];
+    std::string intentFilename;
+
+    // Intent tag of each master file's journal, in MasterFile order; shard journals are "S<shard>"
+    static constexpr const char journalTags[MasterFileCount] = {'A', 'L', 'G'};
+
+    std::string getJournalFilename(int file) const
+    {
+        return filenames[file] + ".delta";
+    }
+
+    static std::vector<std::string> prefixDeltas(char operation, const std::vector<std::string> &payloads)
+    {
+        std::vector<std::string> deltas;
+        deltas.reserve(payloads.size());
+        for (const std::string &payload : payloads)
+            deltas.push_back(operation + payload);
+        return deltas;
+    }
+
+    bool hasDirtyFile() const
+    {
+        return dirty[AccountsFile] || dirty[AvailableGamesFile] || dirty[GamesCollectionFile];
+    }
+
+    // Function to write every master file from SharedData and drop its journals, before the thread runs
+    // Caller holds the SharedData mutex
+    void rewriteMasterFiles()
+    {
+        for (int file = 0; file < MasterFileCount; file++)
+        {
+            std::vector<std::string> records = collectRecords(file);
+            std::string tempFilename = writeTempFile(file, records);
+            if (tempFilename.empty() || std::rename(tempFilename.c_str(), filenames[file].c_str()) != 0)
+            {
+                std::cerr << "Error: Unable to replace " << filenames[file] << " with the in-memory state." << std::endl;
+                if (!tempFilename.empty())
+                    std::remove(tempFilename.c_str());
+                dirty[file] = true;
+                continue;
+            }
+
+            std::remove(getJournalFilename(file).c_str());
+            std::remove((getJournalFilename(file) + ".compacting").c_str());
+            dirty[file] = false;
+            lastWrittenHash[file] = hashFile(filenames[file]);
+            if (file == GamesCollectionFile)
+                sharedData.getCollectionIndex() = buildIndex(records, 25);
+        }
+    }
+
+    // Function to make the shards the live copy: write every shard from SharedData, drop the journals
+    // and shards of the last sharded run and start the shard threads
+    // Caller holds the SharedData mutex
+    void openShards()
+    {
+        // Re-partitioning: make the master files current first, so a crash part way through leaves
+        // the manifest pointing at them rather than at a mix of old and new shards
+        size_t previousShardCount = shardRouter.getPreviousShardCount();
+        if (previousShardCount != 0 && previousShardCount != shards.size())
+        {
+            rewriteMasterFiles();
+            shardRouter.markClean();
+        }
+
+        bool written = true;
+        std::vector<ShardRecords> records = partitionShardRecords();
+        for (std::unique_ptr<Shard> &shard : shards)
+            written = writeShardFiles(shard->index, records[shard->index].data()) && written;
+
+        // Without a full set of shards, carry on unsharded from master files that hold everything
+        written = written && shardRouter.markOpen();
+        if (!written)
+        {
+            std::cerr << "Error: Unable to write the account shards. Continuing with unsharded master files." << std::endl;
+            rewriteMasterFiles();
+            shardRouter.markClean();
+        }
+
+        // What the journals of the last sharded run held is in the files just written
+        removeShardJournals(previousShardCount);
+        size_t staleEnd = written ? previousShardCount : std::max(previousShardCount, shards.size());
+        for (size_t stale = written ? shards.size() : 0; stale < staleEnd; stale++)
+        {
+            std::remove(shardRouter.getShardFilename(AccountsFile, stale).c_str());
+            std::remove(shardRouter.getShardFilename(GamesCollectionFile, stale).c_str());
+        }
+        if (!written)
+        {
+            shards.clear();
+            return;
+        }
+
+        shardsOpen = true;
+        for (std::unique_ptr<Shard> &shard : shards)
+        {
+            shard->stopping = false;
+            shard->worker = std::thread(&Compactor::runShard, this, shard.get());
+        }
+    }
+
+    // Function to stop the shard threads, compact what they left and rebuild the master files from memory
+    void closeShards()
+    {
+        for (std::unique_ptr<Shard> &shard : shards)
+        {
+            {
+                std::lock_guard<std::mutex> lock(shard->stateMutex);
+                shard->stopping = true;
+            }
+            shard->wakeup.notify_all();
+            if (shard->worker.joinable())
+                shard->worker.join();
+            compactShard(*shard);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            dirty[AccountsFile] = true;
+            dirty[GamesCollectionFile] = true;
+        }
+        compact();
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (!hasDirtyFile() && shardRouter.markClean())
+        {
+            removeShardJournals(shards.size());
+            shardsOpen = false;
+        }
+    }
+
+    // Function to drop the shards and shard journals of an interrupted run once the master files
+    // have been rewritten with everything they held, and mark the manifest clean
+    // Caller holds the SharedData mutex
+    void retireInterruptedShards()
+    {
+        if (!shardRouter.wasInterrupted())
+            return;
+        if (hasDirtyFile())
+        {
+            std::cerr << "Error: Unable to fold the shards of the interrupted run into the master files." << std::endl;
+            return;
+        }
+
+        size_t previousShardCount = shardRouter.getPreviousShardCount();
+        if (!shardRouter.markClean())
+            return;
+        removeShardJournals(previousShardCount);
+        for (size_t shard = 0; shard < previousShardCount; shard++)
+        {
+            std::remove(shardRouter.getShardFilename(AccountsFile, shard).c_str());
+            std::remove(shardRouter.getShardFilename(GamesCollectionFile, shard).c_str());
+        }
+    }
+
+    void removeShardJournals(size_t shardCount)
+    {
+        for (size_t shard = 0; shard < shardCount; shard++)
+        {
+            std::string journalFilename = shardRouter.getShardJournalFilename(shard);
+            std::remove(journalFilename.c_str());
+            std::remove((journalFilename + ".compacting").c_str());
+        }
+    }
+
+    // Background loop of one shard's thread
+    void runShard(Shard *shard)
+    {
+        std::unique_lock<std::mutex> lock(shard->stateMutex);
+        while (!shard->stopping)
+        {
+            shard->wakeup.wait(lock, [shard]
+                               { return shard->stopping || shard->dirty; });
+            if (shard->stopping)
+                break;
+
+            // Give foreground transactions a moment to batch up more deltas
+            shard->wakeup.wait_for(lock, std::chrono::milliseconds(compactionDelayMs), [shard]
+                                   { return shard->stopping; });
+
+            lock.unlock();
+            compactShard(*shard);
+            lock.lock();
+        }
+    }
+
+    // Function to rebuild one dirty shard from the in-memory state, as compact() does a master file
+    void compactShard(Shard &shard)
+    {
+        std::lock_guard<std::mutex> compactionLock(shard.compactionMutex);
+        if (failed)
+            return;
+        std::string journalFilename = shardRouter.getShardJournalFilename(shard.index);
+
+        std::vector<std::string> records[2];
+        {
+            std::lock_guard<std::mutex> dataLock(sharedData.getMutex());
+            std::lock_guard<std::mutex> stateLock(shard.stateMutex);
+            if (!shard.dirty)
+                return;
+
+            shard.dirty = false;
+            rotateJournalFile(journalFilename);
+            collectShardRecords(shard.index, records);
+        }
+
+        if (!writeShardFiles(shard.index, records))
+        {
+            // Keep the rotated journal and try again on the next pass
+            std::lock_guard<std::mutex> stateLock(shard.stateMutex);
+            shard.dirty = true;
+            return;
+        }
+        std::remove((journalFilename + ".compacting").c_str());
+    }
+
+    // Account and games collection records of one shard
+    typedef std::array<std::vector<std::string>, 2> ShardRecords;
+
+    // Function to format the account and collection records of the users in one shard
+    void collectShardRecords(size_t shard, std::vector<std::string> records[2])
+    {
+        for (const User &user : sharedData.getUsers())
+        {
+            if (shardRouter.getShard(user.getUsername()) == shard)
+                appendUserRecords(user, records);
+        }
+    }
+
+    // Function to format the records of every shard in one pass over the users
+    std::vector<ShardRecords> partitionShardRecords()
+    {
+        std::vector<ShardRecords> records(shards.size());
+        for (const User &user : sharedData.getUsers())
+            appendUserRecords(user, records[shardRouter.getShard(user.getUsername())].data());
+        return records;
+    }
+
+    static void appendUserRecords(const User &user, std::vector<std::string> records[2])
+    {
+        records[0].push_back(UserUpdater::formatUser(user));
+        for (const std::string &gameName : user.getGameNames())
+            records[1].push_back(GameUpdater::formatCollectionEntry(gameName, user.getUsername()));
+    }
+
+    // Function to replace both files of a shard; returns false if either could not be replaced
+    bool writeShardFiles(size_t shard, const std::vector<std::string> records[2])
+    {
+        bool written = true;
+        for (int file : {AccountsFile, GamesCollectionFile})
+        {
+            std::string shardFilename = shardRouter.getShardFilename(file, shard);
+            std::string tempFilename = writeTempFile(file, records[file == AccountsFile ? 0 : 1], shardFilename);
+            if (tempFilename.empty() || std::rename(tempFilename.c_str(), shardFilename.c_str()) != 0)
+            {
+                std::cerr << "Error: Unable to replace " << shardFilename << " during compaction." << std::endl;
+                if (!tempFilename.empty())
+                    std::remove(tempFilename.c_str());
+                written = false;
+            }
+        }
+        return written;
+    }
+
+    // Function to route deltas to the journals of the shards of the users they are about
+    // Shard journal lines are "A<delta>" for the accounts file and "G<delta>" for the games collection
+    void appendShardDeltas(int file, const std::vector<std::string> &deltas)
+    {
+        std::vector<std::string> lines(shards.size());
+        for (const std::string &delta : deltas)
+        {
+            std::string payload = delta.substr(1);
+            std::string username = payload;
+            if (delta[0] == '+' && file == AccountsFile)
+            {
+                username = FileReader::parseUserRecord(payload).getUsername();
+            }
+            else if (delta[0] == '+')
+            {
+                std::string gameName;
+                FileReader::parseCollectionRecord(payload, gameName, username);
+            }
+
+            Shard &shard = *shards[shardRouter.getShard(username)];
+            std::string line = (file == AccountsFile ? "A" : "G") + delta;
+            if (transferOpen)
+                shard.transferLines.push_back(line);
+            else
+                lines[shard.index].append(line).push_back('\n');
+        }
+
+        for (std::unique_ptr<Shard> &shard : shards)
+        {
+            if (!lines[shard->index].empty())
+                appendShardJournal(*shard, lines[shard->index]);
+        }
+    }
+
+    // Function to append lines to a shard's journal in one write and wake its thread
+    bool appendShardJournal(Shard &shard, const std::string &lines)
+    {
+        {
+            std::lock_guard<std::mutex> lock(shard.stateMutex);
+
+            std::ofstream journal(shardRouter.getShardJournalFilename(shard.index), std::ios::app | std::ios::binary);
+            if (!journal.is_open())
+            {
+                std::cerr << "Error: Unable to open the delta journal for writing." << std::endl;
+                failed = true;
+                return false;
+            }
+            journal.write(lines.data(), lines.size());
+            journal.close();
+            if (journal.fail())
+            {
+                std::cerr << "Error: Unable to write the delta journal." << std::endl;
+                failed = true;
+                return false;
+            }
+
+            shard.dirty = true;
+        }
+        shard.wakeup.notify_all();
+        return true;
+    }
+
+    static std::string joinLines(const std::vector<std::string> &lines)
+    {
+        std::string joined;
+        for (const std::string &line : lines)
+            joined.append(line).push_back('\n');
+        return joined;
+    }
+
+    // Function to append lines to the journal with the given intent tag and wake the thread compacting it
+    bool appendToJournal(const std::string &tag, const std::string &lines)
+    {
+        if (tag[0] == 'S')
+            return appendShardJournal(*shards[std::stoul(tag.substr(1))], lines);
+
+        int file = static_cast<int>(std::find(journalTags, journalTags + MasterFileCount, tag[0]) - journalTags);
+        return appendJournal(file, lines);
+    }
+
+    // Function to write a transfer as the intent record: "<tag> <journal line>" lines, then "E", and sync it
+    bool writeTransferIntent(const std::vector<std::pair<std::string, std::string>> &targets)
+    {
+        std::string intent;
+        for (const auto &target : targets)
+        {
+            size_t start = 0;
+            size_t newline;
+            while ((newline = target.second.find('\n', start)) != std::string::npos)
+            {
+                intent.append(target.first).append(1, ' ').append(target.second, start, newline - start + 1);
+                start = newline + 1;
+            }
+        }
+        intent.append("E\n");
+
+        std::ofstream intentFile(intentFilename, std::ios::binary | std::ios::trunc);
+        intentFile.write(intent.data(), intent.size());
+        intentFile.close();
+
+        // The intent must be on disk, and findable, before any journal gets a line of the transfer
+        return !intentFile.fail() && syncFile(intentFilename) && syncDirectoryOf(intentFilename);
+    }
+
+    // Function to get the journal an intent tag names, or an empty string if it names none
+    std::string getTaggedJournalFilename(const std::string &tag) const
+    {
+        if (tag.length() > 1 && tag[0] == 'S' && tag.length() <= 4 && tag.find_first_not_of("0123456789", 1) == std::string::npos)
+            return shardRouter.getShardJournalFilename(std::stoul(tag.substr(1)));
+
+        const char *found = std::find(journalTags, journalTags + MasterFileCount, tag[0]);
+        if (tag.length() != 1 || found == journalTags + MasterFileCount)
+            return "";
+        return getJournalFilename(static_cast<int>(found - journalTags));
+    }
+
+    // Function to finish the transfer a crash interrupted: a complete intent is appended to its
+    // journals again (replaying a line twice is harmless) and a partial one, which never reached
+    // any journal, is dropped
+    void recoverTransferIntent()
+    {
+        std::ifstream intentFile(intentFilename, std::ios::binary);
+        if (!intentFile.is_open())
+            return;
+
+        std::vector<std::pair<std::string, std::string>> lines;
+        std::string line;
+        bool complete = false;
+        while (std::getline(intentFile, line))
+        {
+            size_t space = line.find(' ');
+            complete = line == "E";
+            if (complete || space == std::string::npos)
+                break;
+            lines.push_back(std::make_pair(line.substr(0, space), line.substr(space + 1) + '\n'));
+        }
+        intentFile.close();
+
+        if (!complete)
+        {
+            std::cerr << "Error: Dropping a transfer interrupted before its intent was recorded." << std::endl;
+        }
+        else
+        {
+            for (const auto &intentLine : lines)
+            {
+                std::string journalFilename = getTaggedJournalFilename(intentLine.first);
+                if (journalFilename.empty())
+                {
+                    std::cerr << "Error: Skipping a malformed line of the transfer intent." << std::endl;
+                    continue;
+                }
+                std::ofstream journal(journalFilename, std::ios::app | std::ios::binary);
+                journal << intentLine.second;
+            }
+        }
+        std::remove(intentFilename.c_str());
+    }
+
+    // Function to apply the shard journals left behind by an interrupted sharded run to SharedData
+    void replayShardJournals()
+    {
+        for (size_t shard = 0; shard < shardRouter.getPreviousShardCount(); shard++)
+        {
+            std::string journalFilename = shardRouter.getShardJournalFilename(shard);
+            for (const std::string &filename : {journalFilename + ".compacting", journalFilename})
+            {
+                std::ifstream journal(filename, std::ios::binary);
+                std::string line;
+                while (std::getline(journal, line))
+                    replayShardLine(line);
+            }
+        }
+    }
+
+    void replayShardLine(const std::string &line)
+    {
+        int file = line.compare(0, 1, "A") == 0 ? AccountsFile : GamesCollectionFile;
+        if (line.length() < 3 || (line[0] != 'A' && line[0] != 'G') || (line[1] != '+' && line[1] != '-') ||
+            (line[1] == '+' && (int)line.length() - 2 != masterRecordLengths[file]))
+        {
+            std::cerr << "Error: Skipping malformed delta in a shard journal." << std::endl;
+            return;
+        }
+
+        if (file == AccountsFile)
+            replayAccountDelta(line[1], line.substr(2));
+        else
+            replayCollectionDelta(line[1], line.substr(2));
+    }
+
+    // Function to append one delta line to a journal and wake the background thread
+    void appendDelta(int file, const std::string &delta)
+    {
+        appendDeltas(file, std::vector<std::string>(1, delta));
+    }
+
+    // Function to append delta lines to a journal, or stage them in the open transfer
+    void appendDeltas(int file, const std::vector<std::string> &deltas)
+    {
+        if (deltas.empty() || failed)
+            return;
+
+        if (!shards.empty() && file != AvailableGamesFile)
+        {
+            appendShardDeltas(file, deltas);
+            return;
+        }
+        if (transferOpen)
+        {
+            transferDeltas[file].insert(transferDeltas[file].end(), deltas.begin(), deltas.end());
+            return;
+        }
+
+        appendJournal(file, joinLines(deltas));
+    }
+
+    // Function to append delta lines to a master file's journal in one write and wake the background thread
+    // A failed write stops every later write, since memory now holds a change the files do not
+    bool appendJournal(int file, const std::string &lines)
+    {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+
+            std::ofstream journal(getJournalFilename(file), std::ios::app | std::ios::binary);
+            if (!journal.is_open())
+            {
+                std::cerr << "Error: Unable to open the delta journal for writing." << std::endl;
+                failed = true;
+                return false;
+            }
+            journal.write(lines.data(), lines.size());
+            journal.close();
+            if (journal.fail())
+            {
+                std::cerr << "Error: Unable to write the delta journal." << std::endl;
+                failed = true;
+                return false;
+            }
+
+            dirty[file] = true;
+        }
+        wakeup.notify_all();
+        return true;
+    }
+
+    // Background thread loop
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        while (!stopping)
+        {
+            wakeup.wait(lock, [this]
+                        { return stopping || hasDirtyFile(); });
+            if (stopping)
+                break;
+
+            // Give foreground transactions a moment to batch up more deltas
+            wakeup.wait_for(lock, std::chrono::milliseconds(compactionDelayMs), [this]
+                            { return stopping; });
+
+            lock.unlock();
+            compact();
+            lock.lock();
+        }
+    }
+
+    // Function to rebuild every dirty master file from the in-memory state
+    void compact()
+    {
+        std::lock_guard<std::mutex> compactionLock(compactionMutex);
+        if (failed)
+            return;
+
+        bool selected[MasterFileCount] = {false, false, false};
+        std::vector<std::string> records[MasterFileCount];
+
+        // Take a consistent copy of the state and rotate the journals it already covers
+        {
+            std::lock_guard<std::mutex> dataLock(sharedData.getMutex());
+            std::lock_guard<std::mutex> stateLock(stateMutex);
+
+            for (int file = 0; file < MasterFileCount; file++)
+            {
+                if (!dirty[file])
+                    continue;
+
+                selected[file] = true;
+                dirty[file] = false;
+                compacting[file] = true;
+                rotateJournal(file);
+                records[file] = collectRecords(file);
+            }
+        }
+
+        // Write the new master files without holding any lock the foreground needs
+        std::string tempFilenames[MasterFileCount];
+        uint64_t tempFileHashes[MasterFileCount] = {0, 0, 0};
+        for (int file = 0; file < MasterFileCount; file++)
+        {
+            if (selected[file])
+            {
+                tempFilenames[file] = writeTempFile(file, records[file]);
+                tempFileHashes[file] = hashFile(tempFilenames[file]);
+            }
+        }
+
+        // Swap the new files in together with the record offsets they imply
+        std::lock_guard<std::mutex> dataLock(sharedData.getMutex());
+        for (int file = 0; file < MasterFileCount; file++)
+        {
+            if (!selected[file])
+                continue;
+
+            if (tempFilenames[file].empty() || std::rename(tempFilenames[file].c_str(), filenames[file].c_str()) != 0)
+            {
+                std::cerr << "Error: Unable to replace " << filenames[file] << " during compaction." << std::endl;
+                if (!tempFilenames[file].empty())
+                    std::remove(tempFilenames[file].c_str());
+
+                // Keep the rotated journal and try again on the next pass
+                std::lock_guard<std::mutex> stateLock(stateMutex);
+                dirty[file] = true;
+                compacting[file] = false;
+                continue;
+            }
+
+            std::remove((getJournalFilename(file) + ".compacting").c_str());
+            {
+                std::lock_guard<std::mutex> stateLock(stateMutex);
+                lastWrittenHash[file] = tempFileHashes[file];
+                compacting[file] = false;
+            }
+
+            if (file == GamesCollectionFile)
+                sharedData.getCollectionIndex() = buildIndex(records[file], 25);
+        }
+    }
+
+    // Function to move the live journal aside so new deltas start a fresh one
+    void rotateJournal(int file)
+    {
+        rotateJournalFile(getJournalFilename(file));
+    }
+
+    void rotateJournalFile(const std::string &journalFilename)
+    {
+        std::string rotatedFilename = journalFilename + ".compacting";
+
+        // A previous failed pass may have left a rotated journal; fold the live one into it
+        std::ifstream rotated(rotatedFilename, std::ios::binary);
+        if (!rotated.is_open())
+        {
+            std::rename(journalFilename.c_str(), rotatedFilename.c_str());
+            return;
+        }
+        rotated.close();
+
+        std::ifstream journal(journalFilename, std::ios::binary);
+        std::ofstream rotatedOut(rotatedFilename, std::ios::app | std::ios::binary);
+        rotatedOut << journal.rdbuf();
+        journal.close();
+        rotatedOut.close();
+        std::remove(journalFilename.c_str());
+    }
+
+    // Function to format every in-memory record belonging to a master file
+    std::vector<std::string> collectRecords(int file)
+    {
+        std::vector<std::string> records;
+
+        if (file == AccountsFile)
+        {
+            for (const User &user : sharedData.getUsers())
+                records.push_back(UserUpdater::formatUser(user));
+        }
+        else if (file == AvailableGamesFile)
+        {
+            for (const Game &game : sharedData.getAvailableGames())
+                records.push_back(GameUpdater::formatAvailableGame(game));
+            for (const Game &game : sharedData.getPendingListings())
+                records.push_back(GameUpdater::formatAvailableGame(game));
+        }
+        else
+        {
+            // Deferred collections are copied through without being materialized
+            for (const User &user : sharedData.getUsers())
+            {
+                for (const std::string &gameName : user.getGameNames())
+                    records.push_back(GameUpdater::formatCollectionEntry(gameName, user.getUsername()));
+            }
+        }
+
+        return records;
+    }
+
+    // Function to write the records and END line to a new temp file next to the master file
+    // Returns the temp filename, or an empty string on failure
+    std::string writeTempFile(int file, const std::vector<std::string> &records)
+    {
+        return writeTempFile(file, records, filenames[file]);
+    }
+
+    // Function to write the records of a master file to a new temp file next to another target (a shard)
+    std::string writeTempFile(int file, const std::vector<std::string> &records, const std::string &targetFilename)
+    {
+        std::string tempFilename = targetFilename + "." + std::to_string(getpid()) + "." + std::to_string(++tempFileCounter) + ".tmp";
+
+        std::ofstream tempFile(tempFilename, std::ios::binary | std::ios::trunc);
+        if (!tempFile.is_open())
+        {
+            std::cerr << "Error: Unable to create temporary file." << std::endl;
+            return "";
+        }
+
+        for (const std::string &record : records)
+            tempFile << record << "\n";
+
+        std::string endLine = "END";
+        endLine.resize(masterRecordLengths[file], ' ');
+        tempFile << endLine << "\n";
+        tempFile.close();
+
+        if (tempFile.fail())
+        {
+            std::remove(tempFilename.c_str());
+            return "";
+        }
+
+        // Make sure the data is on disk before the rename makes it visible
+        syncFile(tempFilename);
+
+        return tempFilename;
+    }
+
+    // Function to flush a file's data to disk; returns false if it could not be
+    static bool syncFile(const std::string &filename)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        bool synced = ::fsync(fd) == 0;
+        ::close(fd);
+        return synced;
+    }
+
+    // Function to flush the directory holding a file, so a file created or removed in it stays so
+    static bool syncDirectoryOf(const std::string &filename)
+    {
+        size_t slash = filename.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : filename.substr(0, slash);
+        return syncFile(directory);
+    }
+
+    // Function to map each username at the given column to the offsets of its records
+    static RecordIndex buildIndex(const std::vector<std::string> &records, int nameColumn)
+    {
+        RecordIndex index;
+        std::streamoff offset = 0;
+        for (const std::string &record : records)
+        {
+            std::string username = record.substr(nameColumn, 16);
+            username.erase(std::remove(username.begin(), username.end(), ' '), username.end());
+            index[username].push_back(offset);
+            offset += record.length() + 1;
+        }
+        return index;
+    }
+
+    // Function to apply a journal left behind by an interrupted run to SharedData
+    // Replaying is idempotent, so a journal applied twice leaves the same state
+    bool replayJournal(int file, const std::string &journalFilename)
+    {
+        std::ifstream journal(journalFilename, std::ios::binary);
+        if (!journal.is_open())
+            return false;
+
+        std::string delta;
+        bool replayed = false;
+        while (std::getline(journal, delta))
+        {
+            if (delta.length() < 2)
+                continue;
+
+            std::string payload = delta.substr(1);
+            if (delta[0] == '+' && (int)payload.length() != masterRecordLengths[file])
+            {
+                std::cerr << "Error: Skipping malformed delta in " << journalFilename << "." << std::endl;
+                continue;
+            }
+
+            if (file == AccountsFile)
+                replayAccountDelta(delta[0], payload);
+            else if (file == AvailableGamesFile)
+                replayListingDelta(delta[0], payload);
+            else
+                replayCollectionDelta(delta[0], payload);
+
+            replayed = true;
+        }
+
+        return replayed;
+    }
+
+    void replayAccountDelta(char operation, const std::string &payload)
+    {
+        std::vector<User> &users = sharedData.getUsers();
+        if (operation == '+')
+        {
+            User user = FileReader::parseUserRecord(payload);
+            if (user.getUsername() == "")
+            {
+                std::cerr << "Error: Skipping a malformed account delta." << std::endl;
+                return;
+            }
+            User *existingUser = sharedData.getUserByUsername(user.getUsername());
+            if (existingUser != nullptr)
+                existingUser->setCredit(user.getCredit());
+            else
+                users.push_back(user);
+        }
+        else
+        {
+            users.erase(std::remove_if(users.begin(), users.end(), [&payload](const User &user)
+                                       { return user.getUsername() == payload; }),
+                        users.end());
+        }
+    }
+
+    void replayListingDelta(char operation, const std::string &payload)
+    {
+        std::vector<Game> &games = sharedData.getAvailableGames();
+        if (operation == '+')
+        {
+            Game game = FileReader::parseAvailableGameRecord(payload);
+            if (game.getGameName() == "")
+            {
+                std::cerr << "Error: Skipping a malformed listing delta." << std::endl;
+                return;
+            }
+            auto existingGame = std::find_if(games.begin(), games.end(), [&game](const Game &listedGame)
+                                             { return listedGame.getGameName() == game.getGameName() &&
+                                                      listedGame.getSellerName() == game.getSellerName(); });
+            if (existingGame == games.end())
+            {
+                games.push_back(game);
+                sharedData.getStoreIndex().add(game);
+            }
+        }
+        else
+        {
+            games.erase(std::remove_if(games.begin(), games.end(), [&payload](const Game &game)
+                                       { return game.getSellerName() == payload; }),
+                        games.end());
+            sharedData.getStoreIndex().removeSeller(payload);
+        }
+    }
+
+    void replayCollectionDelta(char operation, const std::string &payload)
+    {
+        if (operation == '+')
+        {
+            std::string gameName;
+            std::string ownerUsername;
+            FileReader::parseCollectionRecord(payload, gameName, ownerUsername);
+
+            User *owner = sharedData.getUserByUsername(ownerUsername);
+            if (owner != nullptr && !owner->hasGameInCollection(gameName))
+                owner->addGameToCollection(gameName);
+        }
+        else
+        {
+            User *owner = sharedData.getUserByUsername(payload);
+            if (owner != nullptr)
+                owner->clearGamesCollection();
+        }
+    }
+};
+
+#endif
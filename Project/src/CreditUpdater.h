@@ -2,38 +2,34 @@
 #define CREDIT_UPDATER_H
 
 #include "User.h"
-#include "UserUpdater.h"
+#include "Compactor.h"
 #include "SharedData.h"
 
 class CreditUpdater
 {
 public:
-    // Constructor that takes a filename for user data
-    CreditUpdater(SharedData &sharedData, const std::string &userFilename) : userUpdater(userFilename), sharedData(sharedData) {}
+    // Constructor that takes SharedData and the compactor that persists account changes
+    CreditUpdater(SharedData &sharedData, Compactor &compactor) : sharedData(sharedData), compactor(compactor) {}
 
     // Function to update the credit for a user
     void updateCreditForUser(const User *user, double newCredit)
     {
-        // Use UserUpdater to update credit in the file
-        if (userUpdater.openFile())
-        {
-            userUpdater.updateUserCredit(*user, newCredit);
-            userUpdater.closeFile();
-        }
-        else
+        User *updatedUser = updateCreditInSharedData(user->getUsername(), newCredit);
+
+        // Record the new account record; the accounts file is rebuilt in the background
+        if (updatedUser != nullptr)
         {
-            std::cerr << "Error: Unable to open the file for writing." << std::endl;
+            compactor.recordUserUpdate(*updatedUser);
         }
-        updateCreditInSharedData(user->getUsername(), newCredit);
     }
 
 private:
     SharedData &sharedData;
-    // UserUpdater instance for handling file operations
-    UserUpdater userUpdater;
+    // Compactor instance for persisting the updated account
+    Compactor &compactor;
 
     // Function to update the credit in the SharedData object
-    void updateCreditInSharedData(const std::string &username, double newCredit)
+    User *updateCreditInSharedData(const std::string &username, double newCredit)
     {
         // Get the vector of users from SharedData
         std::vector<User> &users = sharedData.getUsers();
@@ -43,10 +39,14 @@ private:
         {
             if (user.getUsername() == username)
             {
+                User before = user;
                 user.setCredit(newCredit);
-                break;
+                sharedData.getChangeFeed().accountChanged(&before, &user);
+                return &user;
             }
         }
+
+        return nullptr;
     }
 };
 
@@ -0,0 +1,65 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+// One non-blank line of a CSV file, split into fields with surrounding spaces removed
+struct CsvRow
+{
+    int lineNumber;
+    std::vector<std::string> fields;
+};
+
+// Reads the simple comma-separated files used by the bulk transactions (no quoting)
+class CsvReader
+{
+public:
+    // Constructor that takes a filename as a parameter
+    CsvReader(const std::string &filename) : filename(filename) {}
+
+    // Function to read every non-blank line of the file; returns false if the file cannot be opened
+    bool readRows(std::vector<CsvRow> &rows)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+
+            CsvRow row = {lineNumber, {}};
+            size_t start = 0;
+            while (true)
+            {
+                size_t comma = line.find(',', start);
+                row.fields.push_back(trimField(line.substr(start, comma == std::string::npos ? std::string::npos : comma - start)));
+                if (comma == std::string::npos)
+                    break;
+                start = comma + 1;
+            }
+            rows.push_back(row);
+        }
+        return true;
+    }
+
+private:
+    // Member variable to store the filename
+    std::string filename;
+
+    static std::string trimField(const std::string &field)
+    {
+        size_t first = field.find_first_not_of(" \t\r");
+        if (first == std::string::npos)
+            return "";
+        return field.substr(first, field.find_last_not_of(" \t\r") - first + 1);
+    }
+};
+
+#endif
@@ -6,6 +6,21 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include "BinaryTransactionJournal.h"
+#include "FixedDecimal.h"
+
+// Receiver of the records of a session as they are added, and of the moment they are in the file
+class TransactionObserver
+{
+public:
+    virtual ~TransactionObserver() {}
+
+    // Function called with each formatted record, newline included, as it is added
+    virtual void transactionAdded(const std::string &transaction) = 0;
+
+    // Function called once the session's records have been appended to the daily transaction file
+    virtual void transactionsWritten() = 0;
+};
 
 class DailyTransactionWriter
 {
@@ -13,15 +28,31 @@ public:
     // Constructor that takes the filename as a parameter
     DailyTransactionWriter(const std::string &filename) : dailyTransactionFilename(filename) {}
 
+    // Function to register an observer of the transactions; it must outlive the writer
+    void addObserver(TransactionObserver &observer)
+    {
+        observers.push_back(&observer);
+    }
+
+    // Function to also record every transaction, untruncated, in a binary journal
+    bool openBinaryJournal(const std::string &filename)
+    {
+        return binaryJournal.open(filename);
+    }
+
     // Function to add a transaction to the daily transactions vector
     void addTransaction(const std::string &transactionString)
     {
         dailyTransactions.push_back(transactionString);
+        for (TransactionObserver *observer : observers)
+            observer->transactionAdded(transactionString);
     }
 
     // Function to add a refund transaction to the daily transactions vector
     void addUserTransaction(const std::string &transactionCode, User &user)
     {
+        addJournalRecord(transactionCode, {user.getUsername(), getUserCodeFromType(user.getType())}, user.getCredit());
+
         std::string username = user.getUsername();
         username.resize(16, ' '); // Ensure the username is 16 characters long
 
@@ -43,6 +74,8 @@ public:
     // Function to add a refund transaction to the daily transactions vector
     void addRefundTransaction(std::string &buyerUsername, std::string &sellerUsername, double refundCredit)
     {
+        addJournalRecord("05", {sellerUsername, buyerUsername}, refundCredit);
+
         sellerUsername.resize(15, '_'); // Ensure the seller username is 15 characters long
         buyerUsername.resize(15, '_');  // Ensure the buyer username is 15 characters long
 
@@ -62,6 +95,8 @@ public:
     // Function to add a sell transaction to the daily transactions vector
     void addSellTransaction(Game &game)
     {
+        addJournalRecord("03", {game.getGameName(), game.getSellerName()}, game.getPrice());
+
         std::string sellerUsername = game.getSellerName();
         sellerUsername.resize(13, ' '); // Ensure the seller username is 13 characters long
 
@@ -84,6 +119,8 @@ public:
     // Function to add a buy transaction to the daily transactions vector
     void addBuyTransaction(Game &game, std::string &buyerUsername)
     {
+        addJournalRecord("04", {game.getGameName(), game.getSellerName(), buyerUsername}, game.getPrice());
+
         std::string sellerUsername = game.getSellerName();
         sellerUsername.resize(15, ' '); // Ensure the seller username is 15 characters long
 
@@ -123,6 +160,12 @@ public:
 
         // Close the file
         closeFile(dailyTransactionFile);
+        binaryJournal.write();
+
+        // The session's transactions are in the file; the next session starts with none
+        dailyTransactions.clear();
+        for (TransactionObserver *observer : observers)
+            observer->transactionsWritten();
     }
 
 private:
@@ -132,6 +175,25 @@ private:
     // Vector to store daily transactions
     std::vector<std::string> dailyTransactions;
 
+    // Observers notified of every transaction added and written
+    std::vector<TransactionObserver *> observers;
+
+    // Untruncated copy of the records, written only once opened
+    BinaryTransactionJournal binaryJournal;
+
+    // Function to add a record to the binary journal, before the text record truncates its names
+    void addJournalRecord(const std::string &transactionCode, std::vector<std::string> fields, double amount)
+    {
+        if (!binaryJournal.isEnabled())
+            return;
+
+        JournalRecord record;
+        record.code = std::stoi(transactionCode);
+        record.fields = std::move(fields);
+        record.cents = amountToCents(amount);
+        binaryJournal.add(record);
+    }
+
     // Function to open the daily transaction file in append mode
     std::ofstream openFile()
     {
@@ -0,0 +1,37 @@
+#ifndef FILE_HASH_H
+#define FILE_HASH_H
+
+#include <cstdint>
+#include <string>
+#include "MappedFile.h"
+
+// Starting value of the 64-bit FNV-1a hash
+const uint64_t fnvOffsetBasis = 14695981039346656037ULL;
+
+// Function to fold bytes into a 64-bit FNV-1a hash
+inline uint64_t hashBytes(const char *data, size_t length, uint64_t hash = fnvOffsetBasis)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Function to fold a file's size and contents into a 64-bit FNV-1a hash
+inline uint64_t hashFile(const std::string &filename, uint64_t hash = fnvOffsetBasis)
+{
+    MappedFile file(filename);
+
+    // Mix in the size first so a missing file and an empty file hash differently
+    uint64_t size = file.isOpen() ? file.size() : UINT64_MAX;
+    hash = hashBytes(reinterpret_cast<const char *>(&size), sizeof(size), hash);
+
+    if (file.size() > 0)
+        hash = hashBytes(file.data(), file.size(), hash);
+
+    return hash;
+}
+
+#endif
@@ -9,6 +9,9 @@
 #include "User.h"
 #include "Game.h"
 #include "general.h"
+#include "RecordIndex.h"
+#include "FixedDecimal.h"
+#include "MasterFileValidator.h"
 
 class FileReader
 {
@@ -28,17 +31,84 @@ public:
         str.erase(std::remove(str.begin(), str.end(), '\r'), str.end());
     }
 
+    // Function to strip the trailing padding from a fixed-width field
+    static void trimPadding(std::string &field)
+    {
+        field.erase(field.find_last_not_of(' ') + 1);
+    }
+
+    // Function to build a User from a 28-character accounts record
+    // Returns User("", 0, 0.0) if the username, type code or credit field is malformed
+    static User parseUserRecord(const std::string &line)
+    {
+        // Extract username, userType, and credit information from the line
+        std::string username = line.substr(0, 16);
+        // Remove underscores from username
+        username.erase(std::remove(username.begin(), username.end(), ' '), username.end());
+
+        int userType = getUserTypeFromCode(line[16], line[17]);
+
+        int64_t creditCents;
+        if (username.empty() || userType == -1 || !parseFixedDecimalCents(line.data() + 19, 9, creditCents))
+            return User("", 0, 0.0);
+
+        return User(username, userType, centsToAmount(creditCents));
+    }
+
+    // Function to build a Game from a 49-character available games record
+    // Returns Game("", "", 0.0) if the game name, seller or price field is malformed
+    static Game parseAvailableGameRecord(const std::string &line)
+    {
+        // Extract game name, seller's username, and price information from the line
+        std::string gameName = line.substr(0, 25);
+        // Remove the padding from game name, keeping the spaces inside it
+        trimPadding(gameName);
+
+        std::string sellerUsername = line.substr(25, 16);
+        // Remove spaces from seller's username
+        sellerUsername.erase(std::remove(sellerUsername.begin(), sellerUsername.end(), ' '), sellerUsername.end());
+
+        int64_t priceCents;
+        if (gameName.empty() || sellerUsername.empty() || !parseFixedDecimalCents(line.data() + 43, 6, priceCents))
+            return Game("", "", 0.0);
+
+        return Game(gameName, sellerUsername, centsToAmount(priceCents));
+    }
+
+    // Function to extract the game name and owner from a 42-character games collection record
+    static void parseCollectionRecord(const std::string &line, std::string &gameName, std::string &ownerUsername)
+    {
+        gameName = line.substr(0, 25);
+        ownerUsername = line.substr(25, 16);
+
+        // Remove the padding from game name and spaces from owner name
+        trimPadding(gameName);
+        ownerUsername.erase(std::remove(ownerUsername.begin(), ownerUsername.end(), ' '), ownerUsername.end());
+    }
+
     // Function to read user data from the file and populate the given vector of users
-    void readUsers(std::vector<User> &users)
+    // Returns false, reading nothing, if the file is not open or fails validation
+    bool readUsers(std::vector<User> &users)
     {
         if (fileStream.is_open())
         {
+            size_t recordCount;
+            if (!validateBeforeReading(AccountsFile, recordCount))
+                return false;
+            users.reserve(users.size() + recordCount);
+
             std::string line;
             std::string endLine = "END";
             endLine.resize(28, ' ');
+            std::streamoff offset = fileStream.tellg();
+            int lineNumber = 0;
             while (std::getline(fileStream, line))
             {
-                trimEnd(line); 
+                std::streamoff recordOffset = offset;
+                offset = fileStream.tellg();
+                lineNumber++;
+
+                trimEnd(line);
                 // Check for the END line to stop reading
                 if (line == endLine)
                     break;
@@ -46,19 +116,12 @@ public:
                 // Ensure the line has the correct length
                 if (line.length() == 28) 
                 {
-                    // Extract username, userType, and credit information from the line
-                    std::string username = line.substr(0, 16);
-                    // Remove underscores from username
-                    username.erase(std::remove(username.begin(), username.end(), ' '), username.end());
-
-                    std::string userTypeCode = line.substr(16, 2);
-                    int userType = getUserTypeFromCode(userTypeCode);
-
-                    double credit = std::stod(line.substr(19, 9));
-
                     // Create a User object and add it to the vector
-                    User user(username, userType, credit);
-                    users.push_back(user);
+                    User user = parseUserRecord(line);
+                    if (user.getUsername() == "")
+                        reportMalformedRecord(lineNumber, recordOffset, line);
+                    else
+                        users.push_back(user);
                 }
                 else
                 {
@@ -72,19 +135,33 @@ public:
         {
             // Notify about an error if the file is not open
             std::cerr << "Error: Unable to read the file. Make sure it is open." << std::endl;
+            return false;
         }
+        return true;
     }
 
     // Function to read available games data from the file and populate the given vector of games
-    void readAvailableGames(std::vector<Game> &games)
+    // Returns false, reading nothing, if the file is not open or fails validation
+    bool readAvailableGames(std::vector<Game> &games)
     {
         if (fileStream.is_open())
         {
+            size_t recordCount;
+            if (!validateBeforeReading(AvailableGamesFile, recordCount))
+                return false;
+            games.reserve(games.size() + recordCount);
+
             std::string line;
             std::string endLine = "END";
             endLine.resize(49, ' ');
+            std::streamoff offset = fileStream.tellg();
+            int lineNumber = 0;
             while (std::getline(fileStream, line))
             {
+                std::streamoff recordOffset = offset;
+                offset = fileStream.tellg();
+                lineNumber++;
+
                 trimEnd(line);
                 // Check for the END line to stop reading
                 if (line == endLine)
@@ -93,19 +170,13 @@ public:
                 // Ensure the line has the correct length
                 if (line.length() == 49)
                 {
-                    // Extract game name, seller's username, and price information from the line
-                    std::string gameName = line.substr(0, 25);
-                    // Remove spaces from game name
-                    gameName.erase(std::remove(gameName.begin(), gameName.end(), ' '), gameName.end());
-
-                    std::string sellerUsername = line.substr(25, 16);
-                    // Remove spaces from seller's username
-                    sellerUsername.erase(std::remove(sellerUsername.begin(), sellerUsername.end(), ' '), sellerUsername.end());
-
-                    double price = std::stod(line.substr(43, 6));
-
                     // Create a Game object and add it to the vector
-                    Game game(gameName, sellerUsername, price);
+                    Game game = parseAvailableGameRecord(line);
+                    if (game.getGameName() == "")
+                    {
+                        reportMalformedRecord(lineNumber, recordOffset, line);
+                        continue;
+                    }
                     games.push_back(game);
                 }
                 else
@@ -120,20 +191,32 @@ public:
         {
             // Notify about an error if the file is not open
             std::cerr << "Error: Unable to read the file. Make sure it is open." << std::endl;
+            return false;
         }
+        return true;
     }
 
     // Function to read games collection data from the file and assign to users in SharedData
-    void readGamesCollection(std::vector<User> &users)
+    // When a collection index is given, the byte offset of each owner's records is recorded in it
+    // Returns false, reading nothing, if the file is not open or fails validation
+    bool readGamesCollection(std::vector<User> &users, RecordIndex *collectionIndex = nullptr)
     {
         if (fileStream.is_open())
         {
+            size_t recordCount;
+            if (!validateBeforeReading(GamesCollectionFile, recordCount))
+                return false;
+
             // Read and assign games collection data to users
             std::string line;
             std::string endLine = "END";
             endLine.resize(42, ' ');
+            std::streamoff offset = fileStream.tellg();
             while (std::getline(fileStream, line))
             {
+                std::streamoff recordOffset = offset;
+                offset = fileStream.tellg();
+
                 trimEnd(line);
                 // Check for the END line to stop reading
                 if (line == endLine)
@@ -142,12 +225,9 @@ public:
                 // Validate line length
                 if (line.length() == 42)
                 {
-                    std::string gameName = line.substr(0, 25);
-                    std::string ownerUsername = line.substr(25, 16);
-
-                    // Remove spaces from game name and owner name
-                    gameName.erase(std::remove(gameName.begin(), gameName.end(), ' '), gameName.end());
-                    ownerUsername.erase(std::remove(ownerUsername.begin(), ownerUsername.end(), ' '), ownerUsername.end());
+                    std::string gameName;
+                    std::string ownerUsername;
+                    parseCollectionRecord(line, gameName, ownerUsername);
 
                     // Find the user with the matching username
                     auto it = std::find_if(users.begin(), users.end(), [ownerUsername](const User &user)
@@ -157,6 +237,9 @@ public:
                     if (it != users.end())
                     {
                         it->addGameToCollection(gameName);
+
+                        if (collectionIndex != nullptr)
+                            (*collectionIndex)[ownerUsername].push_back(recordOffset);
                     }
                     else
                     {
@@ -173,7 +256,51 @@ public:
         {
             // Notify about an error if the file is not open
             std::cerr << "Error: Unable to read the file. Make sure it is open." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Function to record where each owner's games collection records are, without loading them
+    // This is a single pass with no user lookups, used when collections are loaded lazily
+    // Returns false, indexing nothing, if the file is not open or fails validation
+    bool indexGamesCollection(RecordIndex &collectionIndex)
+    {
+        if (fileStream.is_open())
+        {
+            size_t recordCount;
+            if (!validateBeforeReading(GamesCollectionFile, recordCount))
+                return false;
+
+            std::string line;
+            std::string endLine = "END";
+            endLine.resize(42, ' ');
+            std::streamoff offset = fileStream.tellg();
+            while (std::getline(fileStream, line))
+            {
+                std::streamoff recordOffset = offset;
+                offset = fileStream.tellg();
+
+                trimEnd(line);
+                // Check for the END line to stop reading
+                if (line == endLine)
+                    break;
+
+                if (line.length() != 42)
+                    continue;
+
+                std::string ownerUsername = line.substr(25, 16);
+                ownerUsername.erase(std::remove(ownerUsername.begin(), ownerUsername.end(), ' '), ownerUsername.end());
+                collectionIndex[ownerUsername].push_back(recordOffset);
+            }
+        }
+        else
+        {
+            // Notify about an error if the file is not open
+            std::cerr << "Error: Unable to read the file. Make sure it is open." << std::endl;
+            return false;
         }
+        return true;
     }
 
     // Function to close the file if it is open
@@ -186,6 +313,28 @@ public:
     }
 
 private:
+    // Function to validate the whole file up front and get its number of records
+    // A defective file is reported and not read, rather than loaded with some of its records missing
+    bool validateBeforeReading(int masterFile, size_t &recordCount) const
+    {
+        MasterFileCheck check = MasterFileValidator::validateFile(filename, masterFile);
+        recordCount = check.recordCount;
+        if (check.valid)
+            return true;
+
+        std::cerr << "Error: " << filename << " failed validation at line " << check.errorLine
+                  << " (offset " << check.errorOffset << "): " << check.error << ". The file is not loaded." << std::endl;
+        return false;
+    }
+
+    // Function to report a record whose fields could not be parsed; the record is skipped
+    void reportMalformedRecord(int lineNumber, std::streamoff offset, const std::string &line) const
+    {
+        std::cerr << "Error: Malformed record in " << filename << " at line " << lineNumber
+                  << " (offset " << offset << "). Skipping line." << std::endl;
+        std::cerr << "Debug: Line contents - " << line << std::endl;
+    }
+
     // Member variable to store the filename
     std::string filename;
 
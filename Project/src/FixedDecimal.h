@@ -0,0 +1,76 @@
+#ifndef FIXED_DECIMAL_H
+#define FIXED_DECIMAL_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Function to parse a fixed-width decimal field such as "000050.00" or "020.00" into integer cents
+// The field must be all digits apart from a '.' followed by exactly two digits.
+// Returns false, leaving cents untouched, if it is not; never allocates or throws.
+inline bool parseFixedDecimalCents(const char *field, size_t width, int64_t &cents)
+{
+    // Wide enough for the point and two decimals, narrow enough that the value cannot overflow
+    if (width < 4 || width > 18 || field[width - 3] != '.')
+        return false;
+
+    int64_t value = 0;
+    for (size_t i = 0; i < width; i++)
+    {
+        if (i == width - 3)
+            continue;
+
+        unsigned digit = static_cast<unsigned char>(field[i]) - static_cast<unsigned>('0');
+        if (digit > 9)
+            return false;
+        value = value * 10 + digit;
+    }
+
+    cents = value;
+    return true;
+}
+
+// Function to parse an amount typed by a user, such as "100", "12.5" or "0.99", into integer cents
+// Allows at most two decimals and at most 15 digits; returns false, leaving cents untouched, otherwise
+inline bool parseDecimalCents(const std::string &text, int64_t &cents)
+{
+    size_t point = text.find('.');
+    size_t integerDigits = point == std::string::npos ? text.length() : point;
+    size_t decimals = point == std::string::npos ? 0 : text.length() - point - 1;
+    if (integerDigits + decimals == 0 || integerDigits > 13 || decimals > 2 || (point != std::string::npos && decimals == 0))
+        return false;
+
+    int64_t value = 0;
+    for (size_t i = 0; i < text.length(); i++)
+    {
+        if (i == point)
+            continue;
+
+        unsigned digit = static_cast<unsigned char>(text[i]) - static_cast<unsigned>('0');
+        if (digit > 9)
+            return false;
+        value = value * 10 + digit;
+    }
+
+    // Scale a missing or single decimal up to cents
+    for (size_t i = decimals; i < 2; i++)
+        value *= 10;
+
+    cents = value;
+    return true;
+}
+
+// Function to convert integer cents to the amount used by User and Game
+inline double centsToAmount(int64_t cents)
+{
+    return static_cast<double>(cents) / 100.0;
+}
+
+// Function to convert an amount held by User or Game to integer cents, rounding to the nearest cent
+inline int64_t amountToCents(double amount)
+{
+    return std::llround(amount * 100.0);
+}
+
+#endif
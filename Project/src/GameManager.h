@@ -5,27 +5,39 @@
 #include "Game.h"
 #include "GameUpdater.h"
 #include "CreditUpdater.h"
+#include "Compactor.h"
+#include "CollectionLoader.h"
+#include "Options.h"
 #include <iostream>
+#include <map>
+#include <memory>
+#include <unordered_set>
 
 class GameManager
 {
 public:
-    // Add a constructor that accepts SharedData and filename
-    GameManager(SharedData &sharedData, const std::string &currentAccountsFilename, const std::string &availableGamesFilename, const std::string &gamesCollectionFilename)
+    // Add a constructor that accepts SharedData, filenames and the compactor persisting changes
+    GameManager(SharedData &sharedData, const std::string &availableGamesFilename, const std::string &gamesCollectionFilename,
+                Compactor &compactor, const Options &options)
         : sharedData(sharedData),
           gamesCollectionFilename(gamesCollectionFilename),
           availableGamesFileReader(availableGamesFilename),
           gamesCollectionFileReader(gamesCollectionFilename),
           existingGames(sharedData.getAvailableGames()),
-          availableGameUpdater(availableGamesFilename),
-          gamesCollectionUpdater(gamesCollectionFilename),
-          creditUpdater(sharedData, currentAccountsFilename)
+          compactor(compactor),
+          creditUpdater(sharedData, compactor)
     {
+        // The catalog and collections were already restored from an up-to-date snapshot
+        if (sharedData.isLoadedFromSnapshot())
+            return;
+
         // Attempt to open the file for reading
         if (availableGamesFileReader.openFile())
         {
             // Read available games data from the file
-            availableGamesFileReader.readAvailableGames(existingGames);
+            if (!availableGamesFileReader.readAvailableGames(existingGames))
+                sharedData.setLoadFailed();
+            sharedData.getStoreIndex().rebuild(existingGames);
 
             availableGamesFileReader.closeFile();
         }
@@ -35,10 +47,26 @@ public:
         }
 
         // Attempt to open the file for reading
-        if (gamesCollectionFileReader.openFile())
+        if (options.lazyCollections && gamesCollectionFileReader.openFile())
+        {
+            // Only note where each owner's records are; collections load on first use
+            RecordIndex &collectionIndex = sharedData.getCollectionIndex();
+            if (!gamesCollectionFileReader.indexGamesCollection(collectionIndex))
+                sharedData.setLoadFailed();
+            gamesCollectionFileReader.closeFile();
+
+            std::shared_ptr<const CollectionSource> loader = std::make_shared<LazyCollectionLoader>(gamesCollectionFilename, collectionIndex);
+            for (User &user : sharedData.getUsers())
+            {
+                if (collectionIndex.count(user.getUsername()) > 0)
+                    user.setCollectionSource(loader);
+            }
+        }
+        else if (gamesCollectionFileReader.openFile())
         {
             // Read games collection data and assign to users in SharedData
-            gamesCollectionFileReader.readGamesCollection(sharedData.getUsers());
+            if (!gamesCollectionFileReader.readGamesCollection(sharedData.getUsers(), &sharedData.getCollectionIndex()))
+                sharedData.setLoadFailed();
 
             gamesCollectionFileReader.closeFile();
         }
@@ -48,7 +76,8 @@ public:
         }
     }
 
-    Game sellGame()
+    // Function to ask for the name and price of a game to sell; returns false if it cannot be listed
+    bool promptSellGame(std::string &gameName, double &price)
     {
         // Check if a new game for sale can be added in this session
         if (isGameForSaleAdded)
@@ -56,19 +85,16 @@ public:
             std::cout << "A new game for sale has already been added in this session. "
                          "You can only add one game per session."
                       << std::endl;
-            return Game("", "", 0.0);
+            return false;
         }
 
         // if the user is AccountManager, do not let them sell a game
-        if (sharedData.getCurrentUser().getType() == UserType::AccountManager)
+        if (getCurrentUserType() == UserType::AccountManager)
         {
             std::cout << "Error: AccountManager users cannot perform this transaction." << std::endl;
-            return Game("", "", 0.0);
+            return false;
         }
 
-        std::string gameName;
-        double price;
-
         // Get the game name from the user
         std::cout << "Enter the game name (up to 25 characters): ";
         std::cin.ignore(); // Ignore the newline character from the previous input
@@ -78,14 +104,19 @@ public:
         if (gameName.length() > 25)
         {
             std::cout << "Invalid game name length. Maximum length is 25 characters." << std::endl;
-            return Game("", "", 0.0);
+            return false;
         }
 
         // Validate the uniqueness of the game name
-        if (isGameNameAlreadyExists(gameName))
+        bool nameTaken;
+        {
+            std::lock_guard<std::mutex> lock(sharedData.getMutex());
+            nameTaken = isGameNameAlreadyExists(gameName);
+        }
+        if (nameTaken)
         {
             std::cout << "A game with the same name already exists. Please choose a unique name." << std::endl;
-            return Game("", "", 0.0);
+            return false;
         }
 
         // Get the price from the user
@@ -96,6 +127,18 @@ public:
         if (price < 0.01 || price > 999.99)
         {
             std::cout << "Invalid price. The price must be between $0.01 and $999.99." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Function to list a game for sale; the caller holds the SharedData mutex
+    Game sellGame(const std::string &gameName, double price)
+    {
+        // The name may have been listed while the price was asked for
+        if (isGameNameAlreadyExists(gameName))
+        {
+            std::cout << "A game with the same name already exists. Please choose a unique name." << std::endl;
             return Game("", "", 0.0);
         }
 
@@ -103,26 +146,19 @@ public:
         // Create a new Game object
         Game newGame(gameName, sellerUsername, price);
 
-        // Open the file and write the new user information
-        if (availableGameUpdater.openFile())
-        {
-            availableGameUpdater.addGameToAvailable(newGame);
-            availableGameUpdater.closeFile();
-            std::cout << "Game listed for sale." << std::endl;
+        // Hold the listing back from buyers until the next run and record it for the available games file
+        sharedData.getPendingListings().push_back(newGame);
+        compactor.recordListing(newGame);
+        sharedData.getChangeFeed().listingChanged(nullptr, &newGame, true);
 
-            // Set the flag to indicate that a new game for sale has been added in this session
-            isGameForSaleAdded = true;
+        // Set the flag to indicate that a new game for sale has been added in this session
+        isGameForSaleAdded = true;
 
-            return newGame;
-        }
-        else
-        {
-            std::cerr << "Error: Unable to open the file for writing." << std::endl;
-            return Game("", "", 0.0);
-        }
+        return newGame;
     }
 
-    Game buyGame()
+    // Function to ask for the game and seller of a purchase; returns false if nothing can be bought
+    bool promptBuyGame(std::string &gameName, std::string &sellerUsername)
     {
         // Check if a game for purchase has already been bought in this session
         if (isGameBought)
@@ -130,19 +166,16 @@ public:
             std::cout << "A game has already been purchased in this session. "
                          "You can only buy one game per session."
                       << std::endl;
-            return Game("", "", 0.0);
+            return false;
         }
 
         // if the user is AccountManager, do not let them buy a game
-        if (sharedData.getCurrentUser().getType() == UserType::AccountManager)
+        if (getCurrentUserType() == UserType::AccountManager)
         {
             std::cout << "Error: AccountManager users cannot perform this transaction." << std::endl;
-            return Game("", "", 0.0);
+            return false;
         }
 
-        std::string gameName;
-        std::string sellerUsername;
-
         // Get the game name from the user
         std::cout << "Enter the game name you want to buy: ";
         std::cin.ignore(); // Ignore the newline character from the previous input
@@ -151,7 +184,12 @@ public:
         // Get the seller's username from the user
         std::cout << "Enter the seller's username: ";
         std::getline(std::cin, sellerUsername);
+        return true;
+    }
 
+    // Function to buy a game from a seller; the caller holds the SharedData mutex
+    Game buyGame(const std::string &gameName, const std::string &sellerUsername)
+    {
         // Find the game in the available games
         auto gameIterator = std::find_if(existingGames.begin(), existingGames.end(),
                                          [gameName, sellerUsername](const Game &game)
@@ -212,51 +250,315 @@ public:
         creditUpdater.updateCreditForUser(&buyer, buyerNewCredit);
         creditUpdater.updateCreditForUser(seller, sellerNewCredit);
 
-        // Add the game to the buyer's collection
+        // Add the game to the buyer's collection, both for this session and in the shared user list
         buyer.addGameToCollection(gameIterator->getGameName());
+        User *storedBuyer = sharedData.getUserByUsername(buyer.getUsername());
+        if (storedBuyer != nullptr)
+        {
+            storedBuyer->addGameToCollection(gameIterator->getGameName());
+        }
+        compactor.recordOwnership(gameIterator->getGameName(), buyer.getUsername());
+        sharedData.getChangeFeed().ownershipChanged(gameIterator->getGameName(), buyer.getUsername(), true);
+
+        isGameBought = true;
 
-        std::string buyerUsername = buyer.getUsername();
+        return *gameIterator;
+    }
 
-        if (gamesCollectionUpdater.openFile())
+    // Function to ask for the game name and seller pairs of a cart; returns false if nothing can be bought
+    bool promptCart(std::vector<std::pair<std::string, std::string>> &items)
+    {
+        if (isGameBought)
         {
-            gamesCollectionUpdater.addGameToCollection(*gameIterator, buyerUsername);
-            gamesCollectionUpdater.closeFile();
+            std::cout << "A game has already been purchased in this session. "
+                         "You can only buy one game per session."
+                      << std::endl;
+            return false;
+        }
 
-            isGameBought = true;
+        // if the user is AccountManager, do not let them buy a game
+        if (getCurrentUserType() == UserType::AccountManager)
+        {
+            std::cout << "Error: AccountManager users cannot perform this transaction." << std::endl;
+            return false;
+        }
 
-            std::cout << "Game purchased successfully." << std::endl;
+        std::cin.ignore(); // Ignore the newline character from the previous input
+        while (true)
+        {
+            std::string gameName;
+            std::string sellerUsername;
+
+            std::cout << "Enter the game name to add to the cart (leave empty to check out): ";
+            if (!std::getline(std::cin, gameName) || gameName.empty())
+                break;
+
+            std::cout << "Enter the seller's username: ";
+            std::getline(std::cin, sellerUsername);
+            items.push_back(std::make_pair(gameName, sellerUsername));
         }
-        else
+
+        if (items.empty())
         {
-            std::cerr << "Error: Unable to open the file for writing." << std::endl;
+            std::cout << "Error: The cart is empty." << std::endl;
+            return false;
         }
+        return true;
+    }
 
-        return *gameIterator;
+    // Function to buy several games, given as game name and seller pairs, in one transaction; nothing is bought unless all pass
+    // The caller holds the SharedData mutex
+    std::vector<Game> buyCart(const std::vector<std::pair<std::string, std::string>> &items)
+    {
+        User &buyer = sharedData.getCurrentUser();
+        if (buyer.getType() == UserType::SellStandard)
+        {
+            std::cout << "Error: Standard-sell users cannot perform this transaction." << std::endl;
+            return {};
+        }
+
+        // Check every item, keeping what each seller is owed in cents
+        std::vector<Game> cart;
+        std::map<std::string, int64_t> sellerEarnings;
+        std::unordered_set<std::string> cartGameNames;
+        int64_t totalCents = 0;
+        bool valid = true;
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            const std::string &gameName = items[i].first;
+            const std::string &sellerUsername = items[i].second;
+            auto gameIterator = std::find_if(existingGames.begin(), existingGames.end(),
+                                             [&gameName, &sellerUsername](const Game &game)
+                                             {
+                                                 return game.getGameName() == gameName && game.getSellerName() == sellerUsername;
+                                             });
+
+            std::string error;
+            if (gameIterator == existingGames.end())
+                error = "Game not found in the available games.";
+            else if (sharedData.getUserByUsername(sellerUsername) == nullptr)
+                error = "Seller doesn't exist.";
+            else if (buyer.getUsername() == sellerUsername)
+                error = "You are the seller of the game.";
+            else if (buyer.hasGameInCollection(gameName))
+                error = "The buyer already has a copy of the game in their collection.";
+            else if (!cartGameNames.insert(gameName).second)
+                error = "The cart already contains this game.";
+            else if (amountToCents(buyer.getCredit()) < totalCents + amountToCents(gameIterator->getPrice()))
+                error = "The buyer does not have enough money to purchase the cart.";
+
+            if (!error.empty())
+            {
+                std::cout << "Error: Item " << i + 1 << " (" << gameName << "): " << error << std::endl;
+                valid = false;
+                continue;
+            }
+
+            totalCents += amountToCents(gameIterator->getPrice());
+            sellerEarnings[sellerUsername] += amountToCents(gameIterator->getPrice());
+            cart.push_back(*gameIterator);
+        }
+
+        if (!valid)
+        {
+            std::cout << "Nothing was purchased." << std::endl;
+            return {};
+        }
+
+        // Apply every debit, credit and ownership together and record each file's changes in one write
+        std::vector<User> updatedUsers;
+        std::vector<User> previousUsers;
+        std::vector<std::string> gameNames;
+        User *storedBuyer = sharedData.getUserByUsername(buyer.getUsername());
+        buyer.setCredit(centsToAmount(amountToCents(buyer.getCredit()) - totalCents));
+        for (const Game &game : cart)
+        {
+            buyer.addGameToCollection(game.getGameName());
+            gameNames.push_back(game.getGameName());
+        }
+        if (storedBuyer != nullptr)
+        {
+            previousUsers.push_back(*storedBuyer);
+            storedBuyer->setCredit(buyer.getCredit());
+            for (const std::string &gameName : gameNames)
+                storedBuyer->addGameToCollection(gameName);
+            updatedUsers.push_back(*storedBuyer);
+        }
+
+        for (const auto &earnings : sellerEarnings)
+        {
+            User *seller = sharedData.getUserByUsername(earnings.first);
+            previousUsers.push_back(*seller);
+            seller->setCredit(centsToAmount(amountToCents(seller->getCredit()) + earnings.second));
+            updatedUsers.push_back(*seller);
+        }
+
+        compactor.recordUserUpdates(updatedUsers);
+        compactor.recordOwnerships(gameNames, buyer.getUsername());
+
+        ChangeFeed &changeFeed = sharedData.getChangeFeed();
+        for (size_t i = 0; i < updatedUsers.size(); i++)
+            changeFeed.accountChanged(&previousUsers[i], &updatedUsers[i]);
+        for (const std::string &gameName : gameNames)
+            changeFeed.ownershipChanged(gameName, buyer.getUsername(), true);
+
+        isGameBought = true;
+
+        return cart;
     }
 
     void removeUserGames(std::string &username)
     {
-        if (availableGameUpdater.openFile())
+        auto isUsersListing = [&username](const Game &game)
+        { return game.getSellerName() == username; };
+
+        reportRemovedListings([&username](const std::string &sellerUsername)
+                              { return sellerUsername == username; });
+
+        // Drop the user's listings from memory, including those made this run; their collection went with the user
+        std::vector<Game> &pendingListings = sharedData.getPendingListings();
+        pendingListings.erase(std::remove_if(pendingListings.begin(), pendingListings.end(), isUsersListing), pendingListings.end());
+        existingGames.erase(std::remove_if(existingGames.begin(), existingGames.end(), isUsersListing), existingGames.end());
+
+        // The journal is the only record of the deletion; the next compaction rewrites both files
+        compactor.recordListingsDeletion(username);
+        compactor.recordOwnershipDeletion(username);
+
+        // The collection records stay on disk until compaction, which rebuilds the owner index
+        sharedData.getStoreIndex().removeSeller(username);
+        sharedData.getCollectionIndex().erase(username);
+    }
+
+    // Function to remove the listings and collections of many deleted users at once
+    // The deletions go to the journal in one append per file; the next compaction rewrites each file once
+    void removeUsersGames(const std::vector<std::string> &usernames)
+    {
+        std::unordered_set<std::string> deletedUsernames(usernames.begin(), usernames.end());
+        auto isDeletedUsersListing = [&deletedUsernames](const Game &game)
+        { return deletedUsernames.count(game.getSellerName()) != 0; };
+
+        reportRemovedListings([&deletedUsernames](const std::string &sellerUsername)
+                              { return deletedUsernames.count(sellerUsername) != 0; });
+
+        std::vector<Game> &pendingListings = sharedData.getPendingListings();
+        pendingListings.erase(std::remove_if(pendingListings.begin(), pendingListings.end(), isDeletedUsersListing), pendingListings.end());
+        existingGames.erase(std::remove_if(existingGames.begin(), existingGames.end(), isDeletedUsersListing), existingGames.end());
+
+        compactor.recordListingsDeletions(usernames);
+        compactor.recordOwnershipDeletions(usernames);
+
+        // The collection records stay on disk until compaction, which rebuilds the owner index
+        for (const std::string &username : usernames)
         {
-            availableGameUpdater.deleteUserAvailableUserGames(username);
-            availableGameUpdater.closeFile();
+            sharedData.getStoreIndex().removeSeller(username);
+            sharedData.getCollectionIndex().erase(username);
         }
+    }
+
+    // Function to list one page of the store in the order and with the filters of the query
+    // Only the page (and the entries the filters skip) are visited, not the whole catalog
+    void listStorePage(const StoreQuery &query)
+    {
+        const StoreOrderIndex &index = sharedData.getStoreIndex().getIndex(query.order);
+
+        // Start at the cursor, or at the first entry the filters can match in this order
+        StoreOrderIndex::const_iterator entry;
+        if (query.hasCursor)
+            entry = index.upper_bound(query.cursor);
+        else if (query.order == SortByPrice)
+            entry = index.lower_bound(StoreEntry{"", "", query.minPriceCents});
+        else if (query.order == SortBySeller && !query.sellerUsername.empty())
+            entry = index.lower_bound(StoreEntry{"", query.sellerUsername, INT64_MIN});
         else
+            entry = index.begin();
+
+        auto matches = [&query](const StoreEntry &candidate)
+        {
+            return candidate.priceCents >= query.minPriceCents && candidate.priceCents <= query.maxPriceCents &&
+                   (query.sellerUsername.empty() || candidate.sellerUsername == query.sellerUsername);
+        };
+
+        // Past this entry nothing further in the order can match
+        auto pastRange = [&query](const StoreEntry &candidate)
         {
-            std::cerr << "Error: Unable to open the file for writing." << std::endl;
+            return (query.order == SortByPrice && candidate.priceCents > query.maxPriceCents) ||
+                   (query.order == SortBySeller && !query.sellerUsername.empty() && candidate.sellerUsername != query.sellerUsername);
+        };
+
+        auto nextMatch = [&](StoreOrderIndex::const_iterator from)
+        {
+            for (; from != index.end() && !pastRange(*from); ++from)
+            {
+                if (matches(*from))
+                    return from;
+            }
+            return index.end();
+        };
+
+        entry = nextMatch(entry);
+        if (!query.hasCursor)
+        {
+            for (size_t skipped = 0; skipped < (query.page - 1) * query.pageSize && entry != index.end(); skipped++)
+                entry = nextMatch(std::next(entry));
         }
 
-        if (gamesCollectionUpdater.openFile())
+        std::ostringstream page;
+        page << "Available Games:" << '\n';
+        page << std::setw(30) << std::left << "Game Name"
+             << std::setw(20) << std::left << "Seller"
+             << std::setw(10) << std::left << "Price" << '\n';
+
+        size_t shown = 0;
+        const StoreEntry *last = nullptr;
+        for (; entry != index.end() && shown < query.pageSize; entry = nextMatch(std::next(entry)), shown++)
         {
-            gamesCollectionUpdater.deleteUserGamesFromCollection(username);
-            gamesCollectionUpdater.closeFile();
+            page << std::setw(30) << std::left << entry->gameName
+                 << std::setw(20) << std::left << entry->sellerUsername
+                 << std::setw(10) << std::fixed << std::setprecision(2) << centsToAmount(entry->priceCents) << '\n';
+            page << std::string(60, '-') << '\n';
+            last = &*entry;
         }
-        else
+
+        if (shown == 0)
+            page << "No games match." << '\n';
+        else if (entry != index.end())
+            page << "More games follow; continue with: after=" << encodeStoreCursor(*last) << '\n';
+
+        std::cout << page.str() << std::flush;
+    }
+
+    // Function to list the games whose names best match the search text, best match first
+    void searchGames(const std::string &text)
+    {
+        const StoreIndex &storeIndex = sharedData.getStoreIndex();
+        std::vector<GameSearchResult> results = storeIndex.getSearchIndex().search(text, maxSearchResults, minSearchSimilarity);
+        if (results.empty())
         {
-            std::cerr << "Error: Unable to open the file for writing." << std::endl;
+            std::cout << "No games match \"" << text << "\"." << std::endl;
+            return;
         }
 
-        std::cout << "User's games deleted successfully." << std::endl;
+        std::ostringstream page;
+        page << "Search Results:" << '\n';
+        page << std::setw(30) << std::left << "Game Name"
+             << std::setw(20) << std::left << "Seller"
+             << std::setw(10) << std::left << "Price" << '\n';
+
+        // Every listing of each matching name, from the name-ordered index
+        const StoreOrderIndex &byName = storeIndex.getIndex(SortByName);
+        for (const GameSearchResult &result : results)
+        {
+            for (auto entry = byName.lower_bound(StoreEntry{result.gameName, "", INT64_MIN});
+                 entry != byName.end() && entry->gameName == result.gameName; ++entry)
+            {
+                page << std::setw(30) << std::left << entry->gameName
+                     << std::setw(20) << std::left << entry->sellerUsername
+                     << std::setw(10) << std::fixed << std::setprecision(2) << centsToAmount(entry->priceCents) << '\n';
+                page << std::string(60, '-') << '\n';
+            }
+        }
+
+        std::cout << page.str() << std::flush;
     }
 
     void listAvailableGames()
@@ -289,16 +591,16 @@ public:
 
 private:
     SharedData &sharedData;
-    // GameUpdater and FileReader objects to handle file operations
+    // FileReader objects to handle file operations
     FileReader availableGamesFileReader;
     FileReader gamesCollectionFileReader;
-    GameUpdater availableGameUpdater;
-    GameUpdater gamesCollectionUpdater;
+    // Compactor instance for persisting catalog and collection changes
+    Compactor &compactor;
     // CreditUpdater instance for handling credit-related operations
     CreditUpdater creditUpdater;
 
-    // Vector to store existing games
-    std::vector<Game> existingGames;
+    // Reference to the vector of available games in shared data
+    std::vector<Game> &existingGames;
 
     // Filename for games collection data
     const std::string gamesCollectionFilename;
@@ -308,7 +610,18 @@ private:
     // Variable to track whether a game has been bought in this session
     bool isGameBought = false;
 
+    // Most game names a search shows, and how similar a name must be to show without containing the text
+    static constexpr size_t maxSearchResults = 20;
+    static constexpr double minSearchSimilarity = 0.2;
+
     // Helper function to check if a game with the given name already exists
+    // Function to read the current user's type between prompts
+    int getCurrentUserType()
+    {
+        std::lock_guard<std::mutex> lock(sharedData.getMutex());
+        return sharedData.getCurrentUser().getType();
+    }
+
     bool isGameNameAlreadyExists(const std::string &gameName)
     {
         for (const Game &existingGame : existingGames)
@@ -320,6 +633,24 @@ private:
         }
         return false;
     }
+
+    // Function to report the removal of every listing, buyable or pending, of the matching sellers to the change feed
+    template <typename SellerMatches>
+    void reportRemovedListings(SellerMatches sellerMatches)
+    {
+        ChangeFeed &changeFeed = sharedData.getChangeFeed();
+        if (!changeFeed.isEnabled())
+            return;
+
+        for (const std::vector<Game> *games : {&existingGames, &sharedData.getPendingListings()})
+        {
+            for (const Game &game : *games)
+            {
+                if (sellerMatches(game.getSellerName()))
+                    changeFeed.listingChanged(&game, nullptr);
+            }
+        }
+    }
 };
 
 #endif
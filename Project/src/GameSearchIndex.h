@@ -0,0 +1,177 @@
+#ifndef GAME_SEARCH_INDEX_H
+#define GAME_SEARCH_INDEX_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One game name found by a search, with how closely it matches
+struct GameSearchResult
+{
+    std::string gameName;
+    double similarity;
+    bool containsQuery;
+};
+
+// Trigram inverted index over the distinct game names in the store, for fuzzy searches
+class GameSearchIndex
+{
+public:
+    // Function to remove every name from the index
+    void clear()
+    {
+        names.clear();
+        nameIds.clear();
+        postings.clear();
+        sharedCounts.clear();
+    }
+
+    // Function to count one more listing of a game name
+    void add(const std::string &gameName)
+    {
+        auto existing = nameIds.find(gameName);
+        if (existing != nameIds.end())
+        {
+            names[existing->second].listingCount++;
+            return;
+        }
+
+        uint32_t nameId = static_cast<uint32_t>(names.size());
+        IndexedName name = {gameName, normalize(gameName), 0, 1};
+        std::vector<uint32_t> trigrams = extractTrigrams(name.normalizedName);
+        name.trigramCount = static_cast<uint32_t>(trigrams.size());
+        for (uint32_t trigram : trigrams)
+            postings[trigram].push_back(nameId);
+
+        names.push_back(name);
+        nameIds[gameName] = nameId;
+        sharedCounts.push_back(0);
+    }
+
+    // Function to count one listing of a game name less
+    void remove(const std::string &gameName)
+    {
+        auto existing = nameIds.find(gameName);
+        if (existing != nameIds.end() && names[existing->second].listingCount > 0)
+            names[existing->second].listingCount--;
+    }
+
+    // Function to find the game names most similar to the query, best first
+    std::vector<GameSearchResult> search(const std::string &query, size_t maxResults, double minSimilarity) const
+    {
+        std::string normalizedQuery = normalize(query);
+        std::vector<uint32_t> queryTrigrams = extractTrigrams(normalizedQuery);
+
+        // Count shared trigrams per candidate, remembering which counters to reset afterwards
+        std::vector<uint32_t> candidates;
+        for (uint32_t trigram : queryTrigrams)
+        {
+            auto posting = postings.find(trigram);
+            if (posting == postings.end())
+                continue;
+
+            for (uint32_t nameId : posting->second)
+            {
+                if (sharedCounts[nameId]++ == 0)
+                    candidates.push_back(nameId);
+            }
+        }
+
+        std::vector<GameSearchResult> results;
+        for (uint32_t nameId : candidates)
+        {
+            const IndexedName &name = names[nameId];
+            uint32_t shared = sharedCounts[nameId];
+            sharedCounts[nameId] = 0;
+            if (name.listingCount == 0)
+                continue;
+
+            double similarity = static_cast<double>(shared) / (queryTrigrams.size() + name.trigramCount - shared);
+            bool containsQuery = !normalizedQuery.empty() && name.normalizedName.find(normalizedQuery) != std::string::npos;
+            if (containsQuery || similarity >= minSimilarity)
+                results.push_back({name.gameName, similarity, containsQuery});
+        }
+
+        auto better = [](const GameSearchResult &left, const GameSearchResult &right)
+        {
+            if (left.containsQuery != right.containsQuery)
+                return left.containsQuery;
+            if (left.similarity != right.similarity)
+                return left.similarity > right.similarity;
+            return left.gameName < right.gameName;
+        };
+        if (results.size() > maxResults)
+        {
+            std::partial_sort(results.begin(), results.begin() + maxResults, results.end(), better);
+            results.resize(maxResults);
+        }
+        else
+        {
+            std::sort(results.begin(), results.end(), better);
+        }
+        return results;
+    }
+
+    // Function to fold a name to lowercase letters and digits separated by single spaces
+    static std::string normalize(const std::string &text)
+    {
+        std::string normalized;
+        bool pendingSpace = false;
+        for (unsigned char c : text)
+        {
+            if (std::isalnum(c))
+            {
+                if (pendingSpace && !normalized.empty())
+                    normalized.push_back(' ');
+                pendingSpace = false;
+                normalized.push_back(static_cast<char>(std::tolower(c)));
+            }
+            else
+            {
+                pendingSpace = true;
+            }
+        }
+        return normalized;
+    }
+
+private:
+    struct IndexedName
+    {
+        std::string gameName;
+        std::string normalizedName;
+        uint32_t trigramCount;
+        uint32_t listingCount;
+    };
+
+    std::vector<IndexedName> names;
+    std::unordered_map<std::string, uint32_t> nameIds;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+
+    // Scratch counters, one per name, that are back to zero between searches
+    mutable std::vector<uint32_t> sharedCounts;
+
+    // Function to get the distinct trigrams of a normalized name, each packed into 24 bits
+    static std::vector<uint32_t> extractTrigrams(const std::string &normalizedName)
+    {
+        std::vector<uint32_t> trigrams;
+        if (normalizedName.empty())
+            return trigrams;
+
+        std::string padded = "  " + normalizedName + " ";
+        for (size_t i = 0; i + 3 <= padded.length(); i++)
+        {
+            trigrams.push_back(static_cast<uint32_t>(static_cast<unsigned char>(padded[i])) << 16 |
+                               static_cast<uint32_t>(static_cast<unsigned char>(padded[i + 1])) << 8 |
+                               static_cast<uint32_t>(static_cast<unsigned char>(padded[i + 2])));
+        }
+
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+        return trigrams;
+    }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    // Constructor that maps the given file; check isOpen() before using the data
+    MappedFile(const std::string &filename)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat fileStatus;
+        if (::fstat(fd, &fileStatus) == 0)
+        {
+            fileSize = static_cast<size_t>(fileStatus.st_size);
+            opened = true;
+
+            // Empty files cannot be mapped but are still valid, empty input
+            if (fileSize > 0)
+            {
+                void *mapping = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping == MAP_FAILED)
+                {
+                    opened = false;
+                    fileSize = 0;
+                }
+                else
+                {
+                    mappedData = static_cast<const char *>(mapping);
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    // Destructor that releases the mapping
+    ~MappedFile()
+    {
+        if (mappedData != nullptr)
+            ::munmap(const_cast<char *>(mappedData), fileSize);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Getter methods for the mapping
+    bool isOpen() const
+    {
+        return opened;
+    }
+
+    const char *data() const
+    {
+        return mappedData;
+    }
+
+    size_t size() const
+    {
+        return fileSize;
+    }
+
+private:
+    const char *mappedData = nullptr;
+    size_t fileSize = 0;
+    bool opened = false;
+};
+
+#endif
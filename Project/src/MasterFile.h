@@ -0,0 +1,16 @@
+#ifndef MASTER_FILE_H
+#define MASTER_FILE_H
+
+// Enumeration of the fixed-width master files
+enum MasterFile
+{
+    AccountsFile,
+    AvailableGamesFile,
+    GamesCollectionFile,
+    MasterFileCount
+};
+
+// Record lengths of each master file, in MasterFile order
+constexpr int masterRecordLengths[] = {28, 49, 42};
+
+#endif
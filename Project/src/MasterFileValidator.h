@@ -0,0 +1,238 @@
+#ifndef MASTER_FILE_VALIDATOR_H
+#define MASTER_FILE_VALIDATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "general.h"
+#include "MappedFile.h"
+#include "MasterFile.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Outcome of validating a master file: the number of live records, or where the first defect is
+struct MasterFileCheck
+{
+    bool valid = true;
+    size_t recordCount = 0;
+    size_t errorLine = 0;
+    size_t errorOffset = 0;
+    const char *error = "";
+};
+
+// Checks the structure of a whole master file in one pass over its mapping, before it is parsed
+class MasterFileValidator
+{
+public:
+    // Function to map a master file and validate it; a missing file is reported as invalid
+    static MasterFileCheck validateFile(const std::string &filename, int masterFile)
+    {
+        MappedFile file(filename);
+        if (!file.isOpen())
+        {
+            MasterFileCheck check;
+            fail(check, 0, 0, "unable to open the file");
+            return check;
+        }
+        return validate(file.data(), file.size(), masterFile);
+    }
+
+    // Function to validate the contents of a master file
+    static MasterFileCheck validate(const char *data, size_t size, int masterFile)
+    {
+        MasterFileCheck check;
+        const size_t recordLength = masterRecordLengths[masterFile];
+        bool sawEnd = false;
+        size_t lineNumber = 0;
+
+        for (size_t offset = 0; offset < size;)
+        {
+            lineNumber++;
+            size_t newline = findNewline(data, offset, size, recordLength);
+            size_t lineEnd = newline;
+            if (lineEnd > offset && data[lineEnd - 1] == '\r')
+                lineEnd--;
+
+            const char *record = data + offset;
+            size_t length = lineEnd - offset;
+
+            if (length == 0)
+            {
+                // Blank lines carry nothing and are skipped by the readers
+            }
+            else if (sawEnd)
+            {
+                return fail(check, lineNumber, offset, "record after the END record");
+            }
+            else if (length != recordLength)
+            {
+                return fail(check, lineNumber, offset, "wrong record length");
+            }
+            else if (hasControlCharacter(record, recordLength))
+            {
+                return fail(check, lineNumber, offset, "control character inside the record");
+            }
+            else if (isEndRecord(record, recordLength))
+            {
+                sawEnd = true;
+            }
+            else
+            {
+                const char *error = checkFields(record, masterFile);
+                if (error != nullptr)
+                    return fail(check, lineNumber, offset, error);
+                check.recordCount++;
+            }
+
+            offset = newline + 1;
+        }
+
+        if (!sawEnd)
+            return fail(check, lineNumber + 1, size, "missing END record");
+
+        return check;
+    }
+
+private:
+    static MasterFileCheck &fail(MasterFileCheck &check, size_t lineNumber, size_t offset, const char *error)
+    {
+        check.valid = false;
+        check.errorLine = lineNumber;
+        check.errorOffset = offset;
+        check.error = error;
+        return check;
+    }
+
+    // Function to find the newline ending the line at offset, or size if the last line has none
+    // Well-formed records end exactly one record length (or one '\r') later, so that is tried first
+    static size_t findNewline(const char *data, size_t offset, size_t size, size_t recordLength)
+    {
+        for (size_t expected = offset + recordLength; expected <= offset + recordLength + 1; expected++)
+        {
+            if (expected < size && data[expected] == '\n')
+            {
+                // The record itself must not contain an earlier newline
+                const void *earlier = std::memchr(data + offset, '\n', expected - offset);
+                return earlier != nullptr ? static_cast<const char *>(earlier) - data : expected;
+            }
+        }
+
+        const void *newline = std::memchr(data + offset, '\n', size - offset);
+        return newline != nullptr ? static_cast<const char *>(newline) - data : size;
+    }
+
+    static bool isEndRecord(const char *record, size_t length)
+    {
+        return std::memcmp(record, "END", 3) == 0 && isBlank(record + 3, length - 3);
+    }
+
+    // Function to check the amount field and user type code of a record
+    // Returns nullptr if they are well-formed, or a description of the defect
+    static const char *checkFields(const char *record, int masterFile)
+    {
+        if (masterFile == AccountsFile)
+        {
+            if (getUserTypeFromCode(record[16], record[17]) == -1)
+                return "unknown user type code";
+            if (!isFixedDecimal(record, 28, 19, 9))
+                return "malformed credit field";
+        }
+        else if (masterFile == AvailableGamesFile)
+        {
+            if (!isFixedDecimal(record, 49, 43, 6))
+                return "malformed price field";
+        }
+        return nullptr;
+    }
+
+    // Function to check that a field ending the record is digits with a '.' before the last two
+    static bool isFixedDecimal(const char *record, size_t recordLength, size_t fieldStart, size_t fieldWidth)
+    {
+        // Look at the last 16 bytes of the record, which contain the whole field
+        const char *window = record + recordLength - 16;
+        uint32_t fieldBits = ((1u << fieldWidth) - 1) << (fieldStart + 16 - recordLength);
+        uint32_t pointBit = 1u << (fieldStart + fieldWidth - 3 + 16 - recordLength);
+
+        uint32_t digits = digitMask(window);
+        return window[fieldStart + fieldWidth - 3 + 16 - recordLength] == '.' &&
+               (digits & fieldBits) == (fieldBits & ~pointBit);
+    }
+
+#ifdef __SSE2__
+    // Function to get a bit per byte of a 16-byte chunk that is an ASCII digit
+    static uint32_t digitMask(const char *chunk)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(chunk));
+        __m128i offsets = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+        __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(offsets, _mm_set1_epi8(9)), offsets);
+        return static_cast<uint32_t>(_mm_movemask_epi8(isDigit));
+    }
+
+    static bool hasControlCharacter(const char *record, size_t length)
+    {
+        // Overlapping 16-byte loads cover the record; every record is at least 16 bytes long
+        for (size_t i = 0; i < length; i += 16)
+        {
+            size_t start = i + 16 <= length ? i : length - 16;
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(record + start));
+            __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(0x1F)), bytes);
+            if (_mm_movemask_epi8(isControl) != 0)
+                return true;
+        }
+        return false;
+    }
+
+    static bool isBlank(const char *record, size_t length)
+    {
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(record + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '))) != 0xFFFF)
+                return false;
+        }
+        for (; i < length; i++)
+        {
+            if (record[i] != ' ')
+                return false;
+        }
+        return true;
+    }
+#else
+    static uint32_t digitMask(const char *chunk)
+    {
+        uint32_t mask = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            if (static_cast<unsigned char>(chunk[i]) - static_cast<unsigned>('0') <= 9)
+                mask |= 1u << i;
+        }
+        return mask;
+    }
+
+    static bool hasControlCharacter(const char *record, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            if (static_cast<unsigned char>(record[i]) < 0x20)
+                return true;
+        }
+        return false;
+    }
+
+    static bool isBlank(const char *record, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            if (record[i] != ' ')
+                return false;
+        }
+        return true;
+    }
+#endif
+};
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef MASTER_FILE_WATCHER_H
+#define MASTER_FILE_WATCHER_H
+
+#include <atomic>
+#include <cerrno>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "SharedData.h"
+#include "Compactor.h"
+#include "SnapshotStore.h"
+#include "FileReader.h"
+#include "FileHash.h"
+
+// Watches the accounts and available games files for edits by other programs and applies them to SharedData
+class MasterFileWatcher
+{
+public:
+    // Constructor that takes SharedData, the compactor and snapshot store, and the two watched filenames
+    MasterFileWatcher(SharedData &sharedData, Compactor &compactor, SnapshotStore &snapshotStore,
+                      const std::string &accountsFilename, const std::string &availableGamesFilename)
+        : sharedData(sharedData), compactor(compactor), snapshotStore(snapshotStore),
+          filenames{accountsFilename, availableGamesFilename} {}
+
+    // Destructor that stops the watcher thread
+    ~MasterFileWatcher()
+    {
+        stop();
+    }
+
+    MasterFileWatcher(const MasterFileWatcher &) = delete;
+    MasterFileWatcher &operator=(const MasterFileWatcher &) = delete;
+
+    // Function to start watching; the files must already be loaded into SharedData
+    bool start()
+    {
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0)
+        {
+            std::cerr << "Error: Unable to start watching the master files." << std::endl;
+            return false;
+        }
+
+        for (int file = 0; file < WatchedFileCount; file++)
+        {
+            splitPath(filenames[file], directories[file], basenames[file]);
+            watchDescriptors[file] = inotify_add_watch(inotifyFd, directories[file].c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (watchDescriptors[file] < 0)
+            {
+                std::cerr << "Error: Unable to watch the directory " << directories[file] << std::endl;
+                ::close(inotifyFd);
+                inotifyFd = -1;
+                return false;
+            }
+
+            // Changes are measured against the files as they were loaded
+            knownHashes[file] = hashFile(filenames[file]);
+        }
+
+        stopping = false;
+        worker = std::thread(&MasterFileWatcher::run, this);
+        return true;
+    }
+
+    // Function to stop the watcher thread
+    void stop()
+    {
+        if (worker.joinable())
+        {
+            stopping = true;
+            worker.join();
+        }
+
+        if (inotifyFd >= 0)
+        {
+            ::close(inotifyFd);
+            inotifyFd = -1;
+        }
+    }
+
+private:
+    // The watched master files; the games collection file is only ever written by this program
+    enum WatchedFile
+    {
+        WatchedAccounts,
+        WatchedAvailableGames,
+        WatchedFileCount
+    };
+
+    // Reference to the shared data object and the components whose state a reload must respect
+    SharedData &sharedData;
+    Compactor &compactor;
+    SnapshotStore &snapshotStore;
+
+    // Watched files, split into the directory that is watched and the name events are matched on
+    std::string filenames[WatchedFileCount];
+    std::string directories[WatchedFileCount];
+    std::string basenames[WatchedFileCount];
+    int watchDescriptors[WatchedFileCount] = {-1, -1};
+
+    // Hash of each file as it was last loaded, so events that change nothing are ignored
+    uint64_t knownHashes[WatchedFileCount] = {0, 0};
+
+    // Watcher thread state
+    int inotifyFd = -1;
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+
+    // How long the thread waits for events before checking whether it should stop
+    static constexpr int pollTimeoutMs = 200;
+
+    static void splitPath(const std::string &path, std::string &directory, std::string &basename)
+    {
+        size_t slash = path.find_last_of('/');
+        if (slash == std::string::npos)
+        {
+            directory = ".";
+            basename = path;
+        }
+        else
+        {
+            directory = slash == 0 ? "/" : path.substr(0, slash);
+            basename = path.substr(slash + 1);
+        }
+    }
+
+    // Watcher thread loop
+    void run()
+    {
+        alignas(struct inotify_event) char buffer[4096];
+        while (!stopping)
+        {
+            struct pollfd pollFd = {inotifyFd, POLLIN, 0};
+            int ready = ::poll(&pollFd, 1, pollTimeoutMs);
+            if (ready <= 0)
+                continue;
+
+            bool changed[WatchedFileCount] = {false, false};
+            ssize_t length;
+            while ((length = ::read(inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char *cursor = buffer; cursor < buffer + length;)
+                {
+                    const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(cursor);
+                    cursor += sizeof(struct inotify_event) + event->len;
+
+                    if (event->len == 0)
+                        continue;
+                    for (int file = 0; file < WatchedFileCount; file++)
+                    {
+                        if (event->wd == watchDescriptors[file] && basenames[file] == event->name)
+                            changed[file] = true;
+                    }
+                }
+            }
+
+            for (int file = 0; file < WatchedFileCount; file++)
+            {
+                if (changed[file])
+                    reload(file);
+            }
+        }
+    }
+
+    // Function to fold an externally changed master file into SharedData
+    void reload(int file)
+    {
+        int masterFile = file == WatchedAccounts ? AccountsFile : AvailableGamesFile;
+
+        std::lock_guard<std::mutex> dataLock(sharedData.getMutex());
+
+        // Local deltas are still waiting to be compacted, or a compaction is about to replace the file;
+        // they win over the external edit
+        if (!compactor.isClean(masterFile))
+            return;
+
+        uint64_t hash = hashFile(filenames[file]);
+        if (hash == knownHashes[file] || hash == compactor.getLastWrittenHash(masterFile))
+        {
+            knownHashes[file] = hash;
+            return;
+        }
+
+        FileReader reader(filenames[file]);
+        if (!reader.openFile())
+            return;
+
+        try
+        {
+            // An edit that fails validation is ignored until the file changes again
+            if (file == WatchedAccounts)
+            {
+                std::vector<User> users;
+                if (!reader.readUsers(users))
+                {
+                    knownHashes[file] = hash;
+                    return;
+                }
+                applyUsers(users);
+            }
+            else
+            {
+                std::vector<Game> games;
+                if (!reader.readAvailableGames(games))
+                {
+                    knownHashes[file] = hash;
+                    return;
+                }
+                applyAvailableGames(games);
+            }
+        }
+        catch (const std::exception &)
+        {
+            std::cerr << "Error: Unable to parse the changed file " << filenames[file] << std::endl;
+            return;
+        }
+        reader.closeFile();
+
+        knownHashes[file] = hash;
+        sharedData.getChangeFeed().publish();
+
+        // Memory matches the master files again, so the snapshot can follow them
+        if (compactor.isClean())
+            snapshotStore.save();
+    }
+
+    // Function to apply the difference between the users on disk and in memory
+    void applyUsers(const std::vector<User> &fileUsers)
+    {
+        std::map<std::string, const User *> fileUsersByName;
+        for (const User &fileUser : fileUsers)
+            fileUsersByName[fileUser.getUsername()] = &fileUser;
+
+        std::vector<User> &users = sharedData.getUsers();
+        User &currentUser = sharedData.getCurrentUser();
+        ChangeFeed &changeFeed = sharedData.getChangeFeed();
+        for (auto it = users.begin(); it != users.end();)
+        {
+            auto fileUser = fileUsersByName.find(it->getUsername());
+            if (fileUser == fileUsersByName.end())
+            {
+                changeFeed.accountChanged(&*it, nullptr);
+                it = users.erase(it);
+                continue;
+            }
+
+            // Existing users keep their games collection; only the account fields can change
+            if (it->getType() != fileUser->second->getType() || it->getCredit() != fileUser->second->getCredit())
+                changeFeed.accountChanged(&*it, fileUser->second);
+            it->setType(fileUser->second->getType());
+            it->setCredit(fileUser->second->getCredit());
+            if (currentUser.getUsername() == it->getUsername())
+            {
+                currentUser.setType(it->getType());
+                currentUser.setCredit(it->getCredit());
+            }
+
+            fileUsersByName.erase(fileUser);
+            ++it;
+        }
+
+        // Whatever is left is new on disk
+        for (const User &fileUser : fileUsers)
+        {
+            if (fileUsersByName.count(fileUser.getUsername()) != 0)
+            {
+                users.push_back(fileUser);
+                changeFeed.accountChanged(nullptr, &fileUser);
+            }
+        }
+        sharedData.getAccountIndex().invalidate();
+    }
+
+    // Function to apply the difference between the available games on disk and in memory
+    void applyAvailableGames(const std::vector<Game> &fileGames)
+    {
+        // Listings made this run are already in the file but must stay unbuyable until the next run
+        std::map<std::pair<std::string, std::string>, int> pendingCounts;
+        for (const Game &pending : sharedData.getPendingListings())
+            pendingCounts[std::make_pair(pending.getGameName(), pending.getSellerName())]++;
+
+        std::map<std::pair<std::string, std::string>, std::vector<double>> filePrices;
+        for (const Game &fileGame : fileGames)
+        {
+            std::pair<std::string, std::string> key(fileGame.getGameName(), fileGame.getSellerName());
+            auto pending = pendingCounts.find(key);
+            if (pending != pendingCounts.end() && pending->second > 0)
+            {
+                pending->second--;
+                continue;
+            }
+            filePrices[key].push_back(fileGame.getPrice());
+        }
+
+        std::vector<Game> &games = sharedData.getAvailableGames();
+        std::vector<Game> updatedGames;
+        updatedGames.reserve(games.size());
+        ChangeFeed &changeFeed = sharedData.getChangeFeed();
+        for (const Game &game : games)
+        {
+            auto prices = filePrices.find(std::make_pair(game.getGameName(), game.getSellerName()));
+            if (prices == filePrices.end() || prices->second.empty())
+            {
+                changeFeed.listingChanged(&game, nullptr);
+                continue;
+            }
+
+            // Keep the listing, taking the price it has on disk
+            if (prices->second.front() == game.getPrice())
+            {
+                updatedGames.push_back(game);
+            }
+            else
+            {
+                updatedGames.push_back(Game(game.getGameName(), game.getSellerName(), prices->second.front()));
+                changeFeed.listingChanged(&game, &updatedGames.back());
+            }
+            prices->second.erase(prices->second.begin());
+        }
+
+        // Whatever is left is new on disk
+        for (const Game &fileGame : fileGames)
+        {
+            auto prices = filePrices.find(std::make_pair(fileGame.getGameName(), fileGame.getSellerName()));
+            if (prices != filePrices.end() && !prices->second.empty())
+            {
+                updatedGames.push_back(Game(fileGame.getGameName(), fileGame.getSellerName(), prices->second.front()));
+                changeFeed.listingChanged(nullptr, &updatedGames.back());
+                prices->second.erase(prices->second.begin());
+            }
+        }
+
+        games = std::move(updatedGames);
+        sharedData.getStoreIndex().rebuild(games);
+    }
+};
+
+#endif
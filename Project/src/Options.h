@@ -0,0 +1,98 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <iostream>
+#include <string>
+#include "PageCursor.h"
+
+// Optional behaviours selected with flags after the four filenames on the command line
+struct Options
+{
+    // Load a user's games collection from disk the first time it is needed (--lazy-collections)
+    bool lazyCollections = false;
+
+    // Pick up changes other programs make to the accounts and available games files (--watch)
+    bool watchMasterFiles = false;
+
+    // Most accounts listusers sorts in memory; larger tables are sorted on disk (--sort-memory=<records>)
+    size_t maxInMemorySortRecords = 2000000;
+
+    // Sliding-window limits on refunds and credit grants, one rule per line (--velocity-rules=<file>)
+    std::string velocityRulesFilename;
+
+    // Log every change to the master state to "<accounts>.changes" and serve it on "<accounts>.changes.sock" (--change-feed)
+    bool changeFeed = false;
+
+    // Run as a read-only replica of the leader serving its change feed on this socket (--follow=<socket>)
+    std::string leaderSocketPath;
+
+    // Hash-partition the accounts and games collection files into this many shards (--shards=<n>)
+    size_t shardCount = 1;
+
+    // Also write the daily transactions, untruncated and checksummed, to "<transactions>.bin" (--binary-journal)
+    bool binaryJournal = false;
+};
+
+// Function to parse the flags starting at argv[first]; returns false on an unknown flag
+inline bool parseOptions(int argc, char *argv[], int first, Options &options)
+{
+    for (int i = first; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        if (flag == "--lazy-collections")
+        {
+            options.lazyCollections = true;
+        }
+        else if (flag == "--watch")
+        {
+            options.watchMasterFiles = true;
+        }
+        else if (flag.compare(0, 14, "--sort-memory=") == 0)
+        {
+            if (!parseCount(flag.substr(14), 1, 999999999, options.maxInMemorySortRecords))
+            {
+                std::cerr << "Error: Invalid record count in " << flag << std::endl;
+                return false;
+            }
+        }
+        else if (flag == "--binary-journal")
+        {
+            options.binaryJournal = true;
+        }
+        else if (flag == "--change-feed")
+        {
+            options.changeFeed = true;
+        }
+        else if (flag.compare(0, 17, "--velocity-rules=") == 0 && flag.length() > 17)
+        {
+            options.velocityRulesFilename = flag.substr(17);
+        }
+        else if (flag.compare(0, 9, "--shards=") == 0)
+        {
+            if (!parseCount(flag.substr(9), 1, 256, options.shardCount))
+            {
+                std::cerr << "Error: Invalid shard count in " << flag << std::endl;
+                return false;
+            }
+        }
+        else if (flag.compare(0, 9, "--follow=") == 0 && flag.length() > 9)
+        {
+            options.leaderSocketPath = flag.substr(9);
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option " << flag << std::endl;
+            return false;
+        }
+    }
+
+    // The watcher reloads the master files, which are not the live copy while they are sharded
+    if (options.watchMasterFiles && options.shardCount > 1)
+    {
+        std::cerr << "Error: --watch cannot be combined with --shards" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef PAGE_CURSOR_H
+#define PAGE_CURSOR_H
+
+#include <cstddef>
+#include <string>
+
+// Function to get the value of a hexadecimal digit, or -1
+inline int hexValue(char digit)
+{
+    if (digit >= '0' && digit <= '9')
+        return digit - '0';
+    if (digit >= 'a' && digit <= 'f')
+        return digit - 'a' + 10;
+    return -1;
+}
+
+// Function to encode the position of a listed record as a token that can be typed back on one line
+// The fields of the record are joined with '\x1f' and hex encoded
+inline std::string encodePageCursor(const std::string &plain)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    std::string cursor;
+    for (unsigned char c : plain)
+    {
+        cursor.push_back(hexDigits[c >> 4]);
+        cursor.push_back(hexDigits[c & 0xF]);
+    }
+    return cursor;
+}
+
+// Function to decode a token made by encodePageCursor; returns false if it is malformed
+inline bool decodePageCursor(const std::string &cursor, std::string &plain)
+{
+    if (cursor.length() % 2 != 0)
+        return false;
+
+    plain.clear();
+    for (size_t i = 0; i < cursor.length(); i += 2)
+    {
+        int high = hexValue(cursor[i]);
+        int low = hexValue(cursor[i + 1]);
+        if (high < 0 || low < 0)
+            return false;
+        plain.push_back(static_cast<char>(high << 4 | low));
+    }
+    return true;
+}
+
+// Function to parse a whole number such as a page size; returns false unless it is from min to max
+inline bool parseCount(const std::string &text, size_t min, size_t max, size_t &count)
+{
+    if (text.empty() || text.length() > 9)
+        return false;
+
+    size_t value = 0;
+    for (char c : text)
+    {
+        if (c < '0' || c > '9')
+            return false;
+        value = value * 10 + (c - '0');
+    }
+
+    if (value < min || value > max)
+        return false;
+    count = value;
+    return true;
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef PERSISTENT_MAP_H
+#define PERSISTENT_MAP_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "FileHash.h"
+
+// Immutable hash array mapped trie; setting or erasing a key returns a new map sharing the untouched nodes
+template <typename Value>
+class PersistentMap
+{
+public:
+    // Function to look up a key; returns nullptr if it is not in the map
+    const Value *find(const std::string &key) const
+    {
+        uint64_t hash = hashKey(key);
+        const Node *node = root.get();
+        for (int shift = 0; node != nullptr; shift += bitsPerLevel)
+        {
+            uint32_t bit = uint32_t(1) << ((hash >> shift) & levelMask);
+            if ((node->bitmap & bit) == 0)
+                return nullptr;
+
+            const Child &child = node->children[childPosition(node->bitmap, bit)];
+            if (child.leaf == nullptr)
+            {
+                node = child.node.get();
+                continue;
+            }
+            if (child.leaf->hash != hash)
+                return nullptr;
+            for (const auto &entry : child.leaf->entries)
+            {
+                if (entry.first == key)
+                    return &entry.second;
+            }
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+    // Function to get a copy of the map with the key set to the value
+    PersistentMap set(const std::string &key, const Value &value) const
+    {
+        bool added = false;
+        PersistentMap updated;
+        updated.root = setIn(root.get(), hashKey(key), 0, key, value, added);
+        updated.count = count + (added ? 1 : 0);
+        return updated;
+    }
+
+    // Function to get a copy of the map without the key
+    PersistentMap erase(const std::string &key) const
+    {
+        bool removed = false;
+        Child remaining = eraseIn(root, hashKey(key), 0, key, removed);
+        if (!removed)
+            return *this;
+
+        PersistentMap updated;
+        updated.count = count - 1;
+
+        // The root stays a node even when one leaf is left in it
+        if (remaining.leaf != nullptr)
+        {
+            std::shared_ptr<Node> node = std::make_shared<Node>();
+            node->bitmap = uint32_t(1) << (remaining.leaf->hash & levelMask);
+            node->children.push_back(remaining);
+            updated.root = node;
+        }
+        else
+        {
+            updated.root = remaining.node;
+        }
+        return updated;
+    }
+
+    // Function to call visit(key, value) for every entry, in no particular order
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        if (root != nullptr)
+            visitNode(*root, visit);
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+private:
+    static constexpr int bitsPerLevel = 5;
+    static constexpr uint64_t levelMask = 31;
+
+    struct Leaf
+    {
+        uint64_t hash;
+        std::vector<std::pair<std::string, Value>> entries;
+    };
+
+    struct Node;
+
+    // A slot of a node: either a leaf or a node one level down
+    struct Child
+    {
+        std::shared_ptr<const Node> node;
+        std::shared_ptr<const Leaf> leaf;
+    };
+
+    struct Node
+    {
+        uint32_t bitmap = 0;
+        std::vector<Child> children;
+    };
+
+    std::shared_ptr<const Node> root;
+    size_t count = 0;
+
+    static uint64_t hashKey(const std::string &key)
+    {
+        return hashBytes(key.data(), key.length());
+    }
+
+    // Function to get where a slot's child is in the packed children vector
+    static size_t childPosition(uint32_t bitmap, uint32_t bit)
+    {
+        return static_cast<size_t>(__builtin_popcount(bitmap & (bit - 1)));
+    }
+
+    // Function to build the node holding two leaves whose hashes agree on the bits below shift
+    static std::shared_ptr<const Node> joinLeaves(const std::shared_ptr<const Leaf> &first, const std::shared_ptr<const Leaf> &second, int shift)
+    {
+        std::shared_ptr<Node> node = std::make_shared<Node>();
+        uint32_t firstBit = uint32_t(1) << ((first->hash >> shift) & levelMask);
+        uint32_t secondBit = uint32_t(1) << ((second->hash >> shift) & levelMask);
+        if (firstBit == secondBit)
+        {
+            node->bitmap = firstBit;
+            node->children.push_back(Child{joinLeaves(first, second, shift + bitsPerLevel), nullptr});
+            return node;
+        }
+
+        node->bitmap = firstBit | secondBit;
+        node->children.push_back(Child{nullptr, firstBit < secondBit ? first : second});
+        node->children.push_back(Child{nullptr, firstBit < secondBit ? second : first});
+        return node;
+    }
+
+    // Function to copy the path to a key with the key set, sharing everything else
+    static std::shared_ptr<const Node> setIn(const Node *node, uint64_t hash, int shift, const std::string &key, const Value &value, bool &added)
+    {
+        std::shared_ptr<Node> copy = node != nullptr ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+        uint32_t bit = uint32_t(1) << ((hash >> shift) & levelMask);
+        size_t position = childPosition(copy->bitmap, bit);
+
+        if ((copy->bitmap & bit) == 0)
+        {
+            std::shared_ptr<Leaf> leaf = std::make_shared<Leaf>();
+            leaf->hash = hash;
+            leaf->entries.push_back(std::make_pair(key, value));
+            copy->bitmap |= bit;
+            copy->children.insert(copy->children.begin() + position, Child{nullptr, leaf});
+            added = true;
+            return copy;
+        }
+
+        Child &child = copy->children[position];
+        if (child.leaf == nullptr)
+        {
+            child.node = setIn(child.node.get(), hash, shift + bitsPerLevel, key, value, added);
+        }
+        else if (child.leaf->hash == hash)
+        {
+            std::shared_ptr<Leaf> leaf = std::make_shared<Leaf>(*child.leaf);
+            auto entry = leaf->entries.begin();
+            while (entry != leaf->entries.end() && entry->first != key)
+                ++entry;
+            if (entry != leaf->entries.end())
+            {
+                entry->second = value;
+            }
+            else
+            {
+                leaf->entries.push_back(std::make_pair(key, value));
+                added = true;
+            }
+            child.leaf = leaf;
+        }
+        else
+        {
+            std::shared_ptr<Leaf> leaf = std::make_shared<Leaf>();
+            leaf->hash = hash;
+            leaf->entries.push_back(std::make_pair(key, value));
+            child.node = joinLeaves(child.leaf, leaf, shift + bitsPerLevel);
+            child.leaf = nullptr;
+            added = true;
+        }
+        return copy;
+    }
+
+    // Function to copy the path to a key with the key removed
+    // Returns what should take the node's place: a node, a lone leaf to pull up, or nothing
+    static Child eraseIn(const std::shared_ptr<const Node> &node, uint64_t hash, int shift, const std::string &key, bool &removed)
+    {
+        if (node == nullptr)
+            return Child{nullptr, nullptr};
+
+        uint32_t bit = uint32_t(1) << ((hash >> shift) & levelMask);
+        if ((node->bitmap & bit) == 0)
+            return Child{node, nullptr};
+
+        size_t position = childPosition(node->bitmap, bit);
+        const Child &child = node->children[position];
+        Child replacement;
+        if (child.leaf == nullptr)
+        {
+            replacement = eraseIn(child.node, hash, shift + bitsPerLevel, key, removed);
+        }
+        else
+        {
+            if (child.leaf->hash != hash)
+                return Child{node, nullptr};
+
+            std::shared_ptr<Leaf> leaf = std::make_shared<Leaf>(*child.leaf);
+            auto entry = leaf->entries.begin();
+            while (entry != leaf->entries.end() && entry->first != key)
+                ++entry;
+            if (entry == leaf->entries.end())
+                return Child{node, nullptr};
+
+            leaf->entries.erase(entry);
+            removed = true;
+            if (!leaf->entries.empty())
+                replacement.leaf = leaf;
+        }
+
+        if (!removed)
+            return Child{node, nullptr};
+
+        std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+        if (replacement.node == nullptr && replacement.leaf == nullptr)
+        {
+            copy->bitmap &= ~bit;
+            copy->children.erase(copy->children.begin() + position);
+        }
+        else
+        {
+            copy->children[position] = replacement;
+        }
+
+        if (copy->children.empty())
+            return Child{nullptr, nullptr};
+        if (copy->children.size() == 1 && copy->children[0].leaf != nullptr)
+            return copy->children[0];
+        return Child{copy, nullptr};
+    }
+
+    template <typename Visitor>
+    static void visitNode(const Node &node, Visitor &visit)
+    {
+        for (const Child &child : node.children)
+        {
+            if (child.leaf == nullptr)
+            {
+                visitNode(*child.node, visit);
+                continue;
+            }
+            for (const auto &entry : child.leaf->entries)
+                visit(entry.first, entry.second);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef PURCHASE_HISTORY_H
+#define PURCHASE_HISTORY_H
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include "DailyTransactionWriter.h"
+#include "MappedFile.h"
+#include "TransactionLog.h"
+
+// How much one buyer bought from one seller, and how much of it has been refunded
+struct PurchaseTotals
+{
+    int64_t purchasedCents = 0;
+    int64_t refundedCents = 0;
+};
+
+// Index of the purchases (04) and refunds (05) in the daily transaction file, totalled by buyer and seller to check refunds
+class PurchaseHistory : public TransactionObserver
+{
+public:
+    // Constructor that loads the index of the given daily transaction file and brings it up to date
+    PurchaseHistory(const std::string &dailyTransactionFilename)
+        : logFilename(dailyTransactionFilename),
+          indexFilename(dailyTransactionFilename + ".purchases")
+    {
+        load();
+        catchUp();
+    }
+
+    // Function to get how much of what the buyer bought from the seller has not been refunded
+    int64_t getRefundableCents(const std::string &buyerUsername, const std::string &sellerUsername) const
+    {
+        std::string key = makeKey(buyerUsername, sellerUsername);
+        int64_t refundable = 0;
+        for (const std::unordered_map<std::string, PurchaseTotals> *totals : {&logged, &pending})
+        {
+            auto found = totals->find(key);
+            if (found != totals->end())
+                refundable += found->second.purchasedCents - found->second.refundedCents;
+        }
+        return refundable;
+    }
+
+    // Function to record a purchase or refund of the current session
+    void transactionAdded(const std::string &transaction) override
+    {
+        applyRecord(pending, transaction);
+    }
+
+    // Function to fold the session's records in from the log once logout has written them
+    void transactionsWritten() override
+    {
+        pending.clear();
+        catchUp();
+    }
+
+private:
+    std::string logFilename;
+    std::string indexFilename;
+
+    // Totals from the log, and from the current session until it is written to the log
+    std::unordered_map<std::string, PurchaseTotals> logged;
+    std::unordered_map<std::string, PurchaseTotals> pending;
+
+    // Position in the log up to which the index is complete
+    LogWatermark watermark;
+
+    static std::string makeKey(const std::string &buyerUsername, const std::string &sellerUsername)
+    {
+        return buyerUsername.substr(0, 14) + '\x1f' + sellerUsername.substr(0, 15);
+    }
+
+    // Function to apply a 04 or 05 record to the totals; returns false for any other record
+    static bool applyRecord(std::unordered_map<std::string, PurchaseTotals> &totals, const std::string &record)
+    {
+        LoggedBuy buy;
+        LoggedRefund refund;
+        if (parseLoggedBuy(record, buy))
+        {
+            totals[makeKey(buy.buyerUsername, buy.sellerUsername)].purchasedCents += buy.priceCents;
+            return true;
+        }
+        if (parseLoggedRefund(record, refund))
+        {
+            totals[makeKey(refund.buyerUsername, refund.sellerUsername)].refundedCents += refund.creditCents;
+            return true;
+        }
+        return false;
+    }
+
+    // Function to read the index file, leaving an empty index if it is missing or damaged
+    void load()
+    {
+        std::ifstream indexFile(indexFilename);
+        std::map<uint64_t, std::string> unconfirmed;
+        std::string line;
+        while (std::getline(indexFile, line))
+        {
+            std::istringstream fields(line);
+            std::string tag;
+            uint64_t offset;
+            uint64_t hash;
+            fields >> tag >> offset;
+            if (tag == "N")
+            {
+                // The log was replaced; records of the old one that were never confirmed are dropped
+                unconfirmed.clear();
+                watermark = LogWatermark();
+            }
+            else if (tag == "R" && fields && fields.get() == ' ')
+            {
+                // Records count once the watermark after them is written; a retried catch-up repeats offsets
+                std::getline(fields, unconfirmed[offset]);
+            }
+            else if (tag == "W" && fields >> hash)
+            {
+                for (const auto &record : unconfirmed)
+                {
+                    if (record.first >= offset || !applyRecord(logged, record.second))
+                    {
+                        std::cerr << "Error: Damaged purchase index. Rebuilding it from the daily transaction file." << std::endl;
+                        reset();
+                        return;
+                    }
+                }
+                unconfirmed.clear();
+                watermark.offset = offset;
+                watermark.tailHash = hash;
+            }
+            else
+            {
+                std::cerr << "Error: Damaged purchase index. Rebuilding it from the daily transaction file." << std::endl;
+                reset();
+                return;
+            }
+        }
+    }
+
+    // Function to forget the index so the whole log is scanned again
+    void reset()
+    {
+        logged.clear();
+        watermark = LogWatermark();
+        std::ofstream(indexFilename, std::ios::trunc);
+    }
+
+    // Function to index the records the log has gained since the watermark
+    void catchUp()
+    {
+        MappedFile log(logFilename);
+        if (!log.isOpen())
+            return;
+
+        std::ofstream indexFile(indexFilename, std::ios::app);
+        if (!logMatchesWatermark(log, watermark))
+        {
+            // A new log is new purchases; the history of the old one is kept
+            watermark = LogWatermark();
+            indexFile << "N\n";
+        }
+
+        auto indexRecord = [&](const std::string &line, uint64_t offset)
+        {
+            if (applyRecord(logged, line))
+                indexFile << "R " << offset << ' ' << line << '\n';
+        };
+        if (readNewLogRecords(log, watermark, indexRecord))
+            indexFile << "W " << watermark.offset << ' ' << watermark.tailHash << '\n';
+
+        if (indexFile.fail())
+            std::cerr << "Error: Unable to write the purchase index." << std::endl;
+    }
+};
+
+#endif
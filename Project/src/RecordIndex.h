@@ -0,0 +1,12 @@
+#ifndef RECORD_INDEX_H
+#define RECORD_INDEX_H
+
+#include <ios>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Secondary index mapping a username to the byte offsets of that user's records in a master file
+typedef std::unordered_map<std::string, std::vector<std::streamoff>> RecordIndex;
+
+#endif
@@ -0,0 +1,388 @@
+#ifndef REPLICATION_FOLLOWER_H
+#define REPLICATION_FOLLOWER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ChangeFeed.h"
+#include "FileReader.h"
+#include "SharedData.h"
+
+// Keeps SharedData a replica of a leader's by following the leader's change feed socket
+class ReplicationFollower
+{
+public:
+    // Constructor that takes the shared data to keep up to date and the leader's change feed socket
+    ReplicationFollower(SharedData &sharedData, const std::string &leaderSocketPath)
+        : sharedData(sharedData), leaderSocketPath(leaderSocketPath) {}
+
+    // Destructor that stops following
+    ~ReplicationFollower()
+    {
+        stop();
+    }
+
+    ReplicationFollower(const ReplicationFollower &) = delete;
+    ReplicationFollower &operator=(const ReplicationFollower &) = delete;
+
+    // Function to start following the leader on a background thread
+    void start()
+    {
+        stopping = false;
+        worker = std::thread(&ReplicationFollower::run, this);
+    }
+
+    // Function to stop following; the state keeps whatever was applied last
+    void stop()
+    {
+        if (worker.joinable())
+        {
+            stopping = true;
+            worker.join();
+        }
+    }
+
+    // Function to check whether the replica is connected and has a snapshot
+    bool isInSync() const
+    {
+        return inSync;
+    }
+
+    // Function to get the sequence number of the last event applied
+    uint64_t getAppliedSequence() const
+    {
+        return appliedSequence;
+    }
+
+private:
+    SharedData &sharedData;
+    std::string leaderSocketPath;
+
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> inSync{false};
+    std::atomic<uint64_t> appliedSequence{0};
+
+    // How long the thread waits between reconnects, and for data before checking whether it should stop
+    static constexpr int reconnectDelayMs = 1000;
+    static constexpr int pollTimeoutMs = 200;
+
+    // State being received in a snapshot, swapped in whole at its end
+    struct Snapshot
+    {
+        std::vector<User> users;
+        std::vector<Game> availableGames;
+        std::vector<Game> pendingListings;
+        std::vector<std::pair<std::string, std::string>> ownerships; // (game, owner)
+        uint64_t sequence = 0;
+    };
+
+    void run()
+    {
+        bool reportedLoss = false;
+        while (!stopping)
+        {
+            int fd = connectToLeader();
+            if (fd < 0)
+            {
+                if (!reportedLoss)
+                    std::cerr << "Error: Unable to reach the leader at " << leaderSocketPath << "; retrying." << std::endl;
+                reportedLoss = true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(reconnectDelayMs));
+                continue;
+            }
+
+            reportedLoss = false;
+            follow(fd);
+            ::close(fd);
+            if (inSync && !stopping)
+                std::cerr << "Error: Lost the connection to the leader; retrying." << std::endl;
+            inSync = false;
+        }
+    }
+
+    int connectToLeader()
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (leaderSocketPath.length() >= sizeof(address.sun_path))
+            return -1;
+        std::strcpy(address.sun_path, leaderSocketPath.c_str());
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+        const char request[] = "REPLICATE\n";
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            ::send(fd, request, sizeof(request) - 1, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(request) - 1))
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Function to read the snapshot and then the events until the connection drops or the follower stops
+    void follow(int fd)
+    {
+        std::string input;
+        Snapshot snapshot;
+        bool inSnapshot = false;
+        char buffer[65536];
+        while (!stopping)
+        {
+            pollfd readable{fd, POLLIN, 0};
+            int ready = ::poll(&readable, 1, pollTimeoutMs);
+            if (ready < 0 && errno != EINTR)
+                return;
+            if (ready <= 0)
+                continue;
+
+            ssize_t length = ::read(fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                return;
+            input.append(buffer, static_cast<size_t>(length));
+
+            // Apply every complete line received, events in one batch under the lock
+            std::vector<ChangeEvent> events;
+            size_t start = 0;
+            size_t newline;
+            while ((newline = input.find('\n', start)) != std::string::npos)
+            {
+                std::string line = input.substr(start, newline - start);
+                start = newline + 1;
+
+                if (inSnapshot)
+                {
+                    if (line == "END")
+                    {
+                        installSnapshot(snapshot);
+                        snapshot = Snapshot();
+                        inSnapshot = false;
+                    }
+                    else if (!addSnapshotRecord(snapshot, line))
+                    {
+                        std::cerr << "Error: Malformed snapshot record from the leader." << std::endl;
+                        return;
+                    }
+                }
+                else if (line.compare(0, 9, "SNAPSHOT ") == 0)
+                {
+                    snapshot.sequence = std::strtoull(line.c_str() + 9, nullptr, 10);
+                    inSnapshot = true;
+                }
+                else
+                {
+                    ChangeEvent event;
+                    if (!parseChangeEvent(line, event))
+                    {
+                        std::cerr << "Error: Unexpected line from the leader: " << line << std::endl;
+                        return;
+                    }
+                    events.push_back(event);
+                }
+            }
+            input.erase(0, start);
+
+            if (!events.empty())
+                applyEvents(events);
+        }
+    }
+
+    static bool addSnapshotRecord(Snapshot &snapshot, const std::string &line)
+    {
+        if (line.length() < 2 || line[1] != ' ')
+            return false;
+
+        std::string record = line.substr(2);
+        if (line[0] == 'A')
+        {
+            User user = FileReader::parseUserRecord(record);
+            if (user.getUsername() == "")
+                return false;
+            snapshot.users.push_back(user);
+        }
+        else if (line[0] == 'L' || line[0] == 'P')
+        {
+            Game game = FileReader::parseAvailableGameRecord(record);
+            if (game.getGameName() == "")
+                return false;
+            (line[0] == 'L' ? snapshot.availableGames : snapshot.pendingListings).push_back(game);
+        }
+        else if (line[0] == 'O')
+        {
+            std::string gameName;
+            std::string ownerUsername;
+            FileReader::parseCollectionRecord(record, gameName, ownerUsername);
+            snapshot.ownerships.push_back(std::make_pair(gameName, ownerUsername));
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // Function to take the SharedData mutex, giving up if the follower is stopped meanwhile;
+    // stop() is called by a transaction that holds it
+    std::unique_lock<std::mutex> lockSharedData()
+    {
+        std::unique_lock<std::mutex> lock(sharedData.getMutex(), std::defer_lock);
+        while (!lock.try_lock())
+        {
+            if (stopping)
+                return lock;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return lock;
+    }
+
+    void installSnapshot(Snapshot &snapshot)
+    {
+        std::unique_lock<std::mutex> lock = lockSharedData();
+        if (!lock.owns_lock())
+            return;
+
+        std::unordered_map<std::string, size_t> usersByName;
+        for (size_t i = 0; i < snapshot.users.size(); i++)
+            usersByName[snapshot.users[i].getUsername()] = i;
+        for (const auto &ownership : snapshot.ownerships)
+        {
+            auto owner = usersByName.find(ownership.second);
+            if (owner != usersByName.end())
+                snapshot.users[owner->second].addGameToCollection(ownership.first);
+        }
+
+        sharedData.getUsers() = std::move(snapshot.users);
+        sharedData.getAvailableGames() = std::move(snapshot.availableGames);
+        sharedData.getPendingListings() = std::move(snapshot.pendingListings);
+        sharedData.getCollectionIndex().clear();
+        sharedData.getStoreIndex().rebuild(sharedData.getAvailableGames());
+        sharedData.getAccountIndex().invalidate();
+        refreshCurrentUser();
+
+        appliedSequence = snapshot.sequence;
+        inSync = true;
+    }
+
+    void applyEvents(const std::vector<ChangeEvent> &events)
+    {
+        std::unique_lock<std::mutex> lock = lockSharedData();
+        if (!lock.owns_lock())
+            return;
+        bool listingsChanged = false;
+        for (const ChangeEvent &event : events)
+        {
+            if (event.sequence <= appliedSequence)
+                continue;
+
+            if (event.entity == AccountEntity)
+                applyAccountEvent(event);
+            else if (event.entity == ListingEntity)
+                listingsChanged = applyListingEvent(event) || listingsChanged;
+            else
+                applyOwnershipEvent(event);
+            appliedSequence = event.sequence;
+        }
+
+        if (listingsChanged)
+            sharedData.getStoreIndex().rebuild(sharedData.getAvailableGames());
+        sharedData.getAccountIndex().invalidate();
+        refreshCurrentUser();
+    }
+
+    void applyAccountEvent(const ChangeEvent &event)
+    {
+        std::vector<User> &users = sharedData.getUsers();
+        if (event.after.empty())
+        {
+            users.erase(std::remove_if(users.begin(), users.end(), [&event](const User &user)
+                                       { return user.getUsername() == event.key; }),
+                        users.end());
+            return;
+        }
+
+        User updated = FileReader::parseUserRecord(event.after);
+        User *existing = sharedData.getUserByUsername(updated.getUsername());
+        if (existing == nullptr)
+        {
+            users.push_back(updated);
+            return;
+        }
+        existing->setType(updated.getType());
+        existing->setCredit(updated.getCredit());
+    }
+
+    // Function to apply a listing event; returns true if the buyable listings changed
+    bool applyListingEvent(const ChangeEvent &event)
+    {
+        Game game = FileReader::parseAvailableGameRecord(event.after.empty() ? event.before : event.after);
+        auto isListing = [&game](const Game &listed)
+        { return listed.getGameName() == game.getGameName() && listed.getSellerName() == game.getSellerName(); };
+
+        std::vector<Game> &availableGames = sharedData.getAvailableGames();
+        std::vector<Game> &pendingListings = sharedData.getPendingListings();
+        if (event.before.empty())
+        {
+            (event.pending ? pendingListings : availableGames).push_back(game);
+            return !event.pending;
+        }
+
+        auto available = std::find_if(availableGames.begin(), availableGames.end(), isListing);
+        if (!event.after.empty() && available != availableGames.end())
+        {
+            *available = game;
+            return true;
+        }
+
+        bool wasAvailable = available != availableGames.end();
+        availableGames.erase(std::remove_if(availableGames.begin(), availableGames.end(), isListing), availableGames.end());
+        pendingListings.erase(std::remove_if(pendingListings.begin(), pendingListings.end(), isListing), pendingListings.end());
+        return wasAvailable;
+    }
+
+    // Ownership is only ever added; it is removed along with the account
+    void applyOwnershipEvent(const ChangeEvent &event)
+    {
+        if (event.after.empty())
+            return;
+
+        std::string gameName;
+        std::string ownerUsername;
+        FileReader::parseCollectionRecord(event.after, gameName, ownerUsername);
+        User *owner = sharedData.getUserByUsername(ownerUsername);
+        if (owner != nullptr && !owner->hasGameInCollection(gameName))
+            owner->addGameToCollection(gameName);
+    }
+
+    // Function to bring the logged-in user's copy in line with the replicated account
+    void refreshCurrentUser()
+    {
+        User &currentUser = sharedData.getCurrentUser();
+        if (currentUser.getUsername() == "")
+            return;
+
+        User *replicated = sharedData.getUserByUsername(currentUser.getUsername());
+        if (replicated != nullptr)
+        {
+            currentUser.setType(replicated->getType());
+            currentUser.setCredit(replicated->getCredit());
+        }
+    }
+};
+
+#endif
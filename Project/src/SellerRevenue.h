@@ -0,0 +1,204 @@
+#ifndef SELLER_REVENUE_H
+#define SELLER_REVENUE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "DailyTransactionWriter.h"
+#include "MappedFile.h"
+#include "TransactionLog.h"
+
+// Sales totals of one seller
+struct SellerStats
+{
+    int64_t grossCents = 0;
+    int64_t refundedCents = 0;
+    int64_t unitsSold = 0;
+
+    int64_t getNetCents() const
+    {
+        return grossCents - refundedCents;
+    }
+};
+
+// Per-seller sales totals from the 04 and 05 records of the daily transaction file, ranked by net revenue
+class SellerRevenue : public TransactionObserver
+{
+public:
+    // Constructor that loads the totals kept for the given daily transaction file and brings them up to date
+    SellerRevenue(const std::string &dailyTransactionFilename)
+        : logFilename(dailyTransactionFilename),
+          totalsFilename(dailyTransactionFilename + ".revenue")
+    {
+        load();
+        catchUp();
+    }
+
+    // Function to get the sellers with the most net revenue, best first
+    std::vector<std::pair<std::string, SellerStats>> getTopSellers(size_t count) const
+    {
+        std::vector<std::pair<std::string, SellerStats>> topSellers;
+        for (auto rank = ranking.begin(); rank != ranking.end() && topSellers.size() < count; ++rank)
+            topSellers.push_back(*sellers.find(rank->second));
+        return topSellers;
+    }
+
+    // Function to record a buy or refund of the current session
+    void transactionAdded(const std::string &transaction) override
+    {
+        if (applyRecord(transaction, 1))
+            sessionRecords.push_back(transaction);
+    }
+
+    // Function to swap the session's records for the copies logout has written to the log
+    void transactionsWritten() override
+    {
+        for (const std::string &transaction : sessionRecords)
+            applyRecord(transaction, -1);
+        sessionRecords.clear();
+        catchUp();
+    }
+
+private:
+    // Ordering of the ranking: most net revenue first, then by name
+    struct RankLess
+    {
+        bool operator()(const std::pair<int64_t, std::string> &left, const std::pair<int64_t, std::string> &right) const
+        {
+            return left.first != right.first ? left.first > right.first : left.second < right.second;
+        }
+    };
+
+    std::string logFilename;
+    std::string totalsFilename;
+
+    // Totals by seller, and (net revenue, seller) pairs in rank order
+    std::unordered_map<std::string, SellerStats> sellers;
+    std::set<std::pair<int64_t, std::string>, RankLess> ranking;
+
+    // Records of the current session that are not in the log yet
+    std::vector<std::string> sessionRecords;
+
+    // Position in the log up to which the totals are complete
+    LogWatermark watermark;
+
+    // Function to change the totals of a seller, keeping its place in the ranking
+    void addToSeller(const std::string &sellerUsername, int64_t grossCents, int64_t refundedCents, int64_t unitsSold)
+    {
+        SellerStats &stats = sellers[sellerUsername];
+        ranking.erase(std::make_pair(stats.getNetCents(), sellerUsername));
+
+        stats.grossCents += grossCents;
+        stats.refundedCents += refundedCents;
+        stats.unitsSold += unitsSold;
+        if (stats.grossCents == 0 && stats.refundedCents == 0 && stats.unitsSold == 0)
+            sellers.erase(sellerUsername);
+        else
+            ranking.insert(std::make_pair(stats.getNetCents(), sellerUsername));
+    }
+
+    // Function to add (sign 1) or take back (sign -1) a 04 or 05 record; returns false for any other record
+    bool applyRecord(const std::string &record, int sign)
+    {
+        LoggedBuy buy;
+        LoggedRefund refund;
+        if (parseLoggedBuy(record, buy))
+        {
+            addToSeller(buy.sellerUsername, sign * buy.priceCents, 0, sign);
+            return true;
+        }
+        if (parseLoggedRefund(record, refund))
+        {
+            addToSeller(refund.sellerUsername, 0, sign * refund.creditCents, 0);
+            return true;
+        }
+        return false;
+    }
+
+    // Function to forget damaged totals so the whole log is read again
+    void reset()
+    {
+        sellers.clear();
+        ranking.clear();
+        watermark = LogWatermark();
+    }
+
+    // Function to read the saved totals, leaving none if they are missing or damaged
+    // Format: "W <offset> <hash>" then one "S <gross cents> <refunded cents> <units> <seller>" per seller
+    void load()
+    {
+        std::ifstream totalsFile(totalsFilename);
+        if (!totalsFile.is_open())
+            return;
+
+        std::string tag;
+        totalsFile >> tag >> watermark.offset >> watermark.tailHash;
+        bool valid = tag == "W" && !totalsFile.fail();
+
+        std::string line;
+        std::getline(totalsFile, line);
+        while (valid && std::getline(totalsFile, line))
+        {
+            std::istringstream fields(line);
+            SellerStats stats;
+            std::string sellerUsername;
+            valid = fields >> tag >> stats.grossCents >> stats.refundedCents >> stats.unitsSold && tag == "S" &&
+                    fields.get() == ' ' && std::getline(fields, sellerUsername) && !sellerUsername.empty();
+            if (valid)
+                addToSeller(sellerUsername, stats.grossCents, stats.refundedCents, stats.unitsSold);
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Error: Damaged seller revenue totals. Rebuilding them from the daily transaction file." << std::endl;
+            reset();
+        }
+    }
+
+    // Function to write the totals and their watermark, replacing the saved ones in one rename
+    void save()
+    {
+        std::string tempFilename = totalsFilename + ".tmp";
+        std::ofstream totalsFile(tempFilename, std::ios::trunc);
+        totalsFile << "W " << watermark.offset << ' ' << watermark.tailHash << '\n';
+        for (const auto &seller : sellers)
+        {
+            totalsFile << "S " << seller.second.grossCents << ' ' << seller.second.refundedCents << ' '
+                       << seller.second.unitsSold << ' ' << seller.first << '\n';
+        }
+        totalsFile.close();
+
+        if (totalsFile.fail() || std::rename(tempFilename.c_str(), totalsFilename.c_str()) != 0)
+        {
+            std::cerr << "Error: Unable to save the seller revenue totals." << std::endl;
+            std::remove(tempFilename.c_str());
+        }
+    }
+
+    // Function to add the records the log has gained since the watermark, and save the totals if there were any
+    void catchUp()
+    {
+        MappedFile log(logFilename);
+        if (!log.isOpen())
+            return;
+
+        if (!logMatchesWatermark(log, watermark))
+            watermark = LogWatermark();
+
+        auto addRecord = [this](const std::string &line, uint64_t)
+        {
+            applyRecord(line, 1);
+        };
+        if (readNewLogRecords(log, watermark, addRecord))
+            save();
+    }
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef SHARD_ROUTER_H
+#define SHARD_ROUTER_H
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "FileHash.h"
+#include "MasterFile.h"
+
+// Hash-partitions the accounts and games collection files into shards ("<file>.shard<k>") by username
+class ShardRouter
+{
+public:
+    // Constructor that takes the number of shards (1 leaves the files unsharded) and the master
+    // filenames, and rebuilds the master files from the shards of an interrupted run
+    ShardRouter(size_t shardCount, const std::string &accountsFilename, const std::string &gamesCollectionFilename)
+        : shardCount(shardCount),
+          manifestFilename(accountsFilename + ".shards"),
+          filenames{accountsFilename, gamesCollectionFilename}
+    {
+        std::ifstream manifest(manifestFilename);
+        std::string state;
+        interrupted = manifest >> state >> previousShardCount && state == "open";
+        if (interrupted)
+            recoverMasterFiles();
+        else if (state != "clean")
+            previousShardCount = 0;
+    }
+
+    bool isSharded() const
+    {
+        return shardCount > 1;
+    }
+
+    size_t getShardCount() const
+    {
+        return shardCount;
+    }
+
+    // Function to get the number of shards the last sharded run used, 0 if there was none
+    size_t getPreviousShardCount() const
+    {
+        return previousShardCount;
+    }
+
+    // Function to check whether the last sharded run stopped with the shards still the live copy,
+    // so its shard journals have yet to be folded into the master files
+    bool wasInterrupted() const
+    {
+        return interrupted;
+    }
+
+    // Function to get the shard a user's records belong to
+    size_t getShard(const std::string &username) const
+    {
+        return hashBytes(username.data(), username.length()) % shardCount;
+    }
+
+    // Function to get the filename of one shard of the accounts or games collection file
+    std::string getShardFilename(int file, size_t shard) const
+    {
+        return filenames[file == AccountsFile ? 0 : 1] + ".shard" + std::to_string(shard);
+    }
+
+    // Function to get the delta journal of a shard, holding the changes to both of its files
+    std::string getShardJournalFilename(size_t shard) const
+    {
+        return filenames[0] + ".shard" + std::to_string(shard) + ".delta";
+    }
+
+    // Function to record that the shards are now the live copy
+    bool markOpen()
+    {
+        return writeManifest("open");
+    }
+
+    // Function to record that the master files have been rebuilt from the shards
+    bool markClean()
+    {
+        if (!writeManifest("clean"))
+            return false;
+        interrupted = false;
+        return true;
+    }
+
+private:
+    size_t shardCount;
+    size_t previousShardCount = 0;
+    bool interrupted = false;
+    std::string manifestFilename;
+
+    // Accounts and games collection filenames
+    std::string filenames[2];
+
+    bool writeManifest(const std::string &state)
+    {
+        std::string tempFilename = manifestFilename + ".tmp";
+        std::ofstream manifest(tempFilename, std::ios::trunc);
+        manifest << state << ' ' << shardCount << '\n';
+        manifest.close();
+
+        if (manifest.fail() || std::rename(tempFilename.c_str(), manifestFilename.c_str()) != 0)
+        {
+            std::cerr << "Error: Unable to write the shard manifest " << manifestFilename << "." << std::endl;
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+        previousShardCount = shardCount;
+        return true;
+    }
+
+    // Function to concatenate the shards of the last run into the master files
+    void recoverMasterFiles()
+    {
+        for (int file : {AccountsFile, GamesCollectionFile})
+        {
+            const std::string &masterFilename = filenames[file == AccountsFile ? 0 : 1];
+            std::string tempFilename = masterFilename + ".shards.tmp";
+            std::ofstream merged(tempFilename, std::ios::binary | std::ios::trunc);
+
+            std::string endLine = "END";
+            endLine.resize(masterRecordLengths[file], ' ');
+
+            bool complete = merged.is_open();
+            for (size_t shard = 0; complete && shard < previousShardCount; shard++)
+            {
+                std::ifstream shardFile(masterFilename + ".shard" + std::to_string(shard), std::ios::binary);
+                complete = shardFile.is_open();
+
+                std::string record;
+                while (complete && std::getline(shardFile, record) && record != endLine)
+                    merged << record << '\n';
+            }
+
+            merged << endLine << '\n';
+            merged.close();
+
+            if (!complete || merged.fail() || std::rename(tempFilename.c_str(), masterFilename.c_str()) != 0)
+            {
+                std::cerr << "Error: Unable to rebuild " << masterFilename << " from its shards." << std::endl;
+                std::remove(tempFilename.c_str());
+            }
+        }
+    }
+};
+
+#endif
@@ -1,8 +1,13 @@
 #ifndef SHARED_DATA_H
 #define SHARED_DATA_H
 
+#include <mutex>
 #include <vector>
 #include "User.h"
+#include "RecordIndex.h"
+#include "StoreIndex.h"
+#include "AccountIndex.h"
+#include "ChangeFeed.h"
 
 class SharedData
 {
@@ -25,6 +30,66 @@ public:
         return availableGames;
     }
 
+    // Function to get a reference to the games listed this run, which cannot be bought until the next run
+    std::vector<Game> &getPendingListings()
+    {
+        return pendingListings;
+    }
+
+    // Function to check whether the state was loaded from a binary snapshot instead of the master files
+    bool isLoadedFromSnapshot() const
+    {
+        return loadedFromSnapshot;
+    }
+
+    // Function to set whether the state was loaded from a binary snapshot
+    void setLoadedFromSnapshot(bool loaded)
+    {
+        loadedFromSnapshot = loaded;
+    }
+
+    // Function to check whether a master file failed validation and was not loaded
+    bool isLoadFailed() const
+    {
+        return loadFailed;
+    }
+
+    // Function to record that a master file failed validation and was not loaded
+    void setLoadFailed()
+    {
+        loadFailed = true;
+    }
+
+    // Function to get the mutex guarding the shared data against the background threads
+    std::mutex &getMutex()
+    {
+        return mutex;
+    }
+
+    // Function to get a reference to the owner index over the games collection file
+    RecordIndex &getCollectionIndex()
+    {
+        return collectionIndex;
+    }
+
+    // Function to get a reference to the ordered indexes over the available games
+    StoreIndex &getStoreIndex()
+    {
+        return storeIndex;
+    }
+
+    // Function to get a reference to the sorted views of the users
+    AccountIndex &getAccountIndex()
+    {
+        return accountIndex;
+    }
+
+    // Function to get a reference to the change data capture log the managers report changes to
+    ChangeFeed &getChangeFeed()
+    {
+        return changeFeed;
+    }
+
     User *getUserByUsername(const std::string &username)
     {
         for (User &user : users)
@@ -65,6 +130,30 @@ private:
     std::vector<User> users;
     // Member variable representing the vector of games
     std::vector<Game> availableGames;
+
+    // Member variable representing the games listed for sale during this run
+    std::vector<Game> pendingListings;
+
+    // Member variable recording whether the master files were skipped in favour of the snapshot
+    bool loadedFromSnapshot = false;
+
+    // Member variable recording whether a master file was refused, leaving the state incomplete
+    bool loadFailed = false;
+
+    // Member variable guarding the shared data while a transaction or compaction is using it
+    std::mutex mutex;
+
+    // Member variable mapping owners to their records on disk
+    RecordIndex collectionIndex;
+
+    // Member variable holding the available games in each order the store can be listed in
+    StoreIndex storeIndex;
+
+    // Member variable holding the users sorted in each order they have been listed in
+    AccountIndex accountIndex;
+
+    // Member variable holding the change data capture log (off unless opened)
+    ChangeFeed changeFeed;
 };
 
 #endif
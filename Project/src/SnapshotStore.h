@@ -0,0 +1,301 @@
+#ifndef SNAPSHOT_STORE_H
+#define SNAPSHOT_STORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "SharedData.h"
+#include "FileHash.h"
+#include "MappedFile.h"
+#include "RecordIndex.h"
+
+// Identification of the snapshot format; bump the version whenever a layout below changes
+const char snapshotMagic[8] = {'S', 'T', 'M', '2', 'S', 'N', 'A', 'P'};
+const uint32_t snapshotVersion = 2;
+const uint32_t snapshotByteOrderMark = 0x01020304;
+
+// Longest name (plus terminator) a snapshot record can hold
+const size_t snapshotNameLength = 32;
+
+// Fixed-size records of the snapshot file, laid out one array after another:
+// header, users, owned games (grouped by user, in user order), games, collection index
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint64_t sourceHash;
+    uint64_t userCount;
+    uint64_t ownedGameCount;
+    uint64_t gameCount;
+    uint64_t collectionIndexCount;
+};
+
+struct SnapshotUser
+{
+    char username[snapshotNameLength];
+    int32_t type;
+    uint32_t ownedGameCount;
+    double credit;
+};
+
+struct SnapshotOwnedGame
+{
+    char gameName[snapshotNameLength];
+};
+
+struct SnapshotGame
+{
+    char gameName[snapshotNameLength];
+    char sellerName[snapshotNameLength];
+    double price;
+};
+
+struct SnapshotIndexEntry
+{
+    char username[snapshotNameLength];
+    int64_t offset;
+};
+
+// Binary image of SharedData ("<accounts file>.snapshot"), used at start while the master files still match its hash
+class SnapshotStore
+{
+public:
+    // Constructor that takes SharedData and the three master filenames, and tries to load the snapshot
+    SnapshotStore(SharedData &sharedData, const std::string &accountsFilename,
+                  const std::string &availableGamesFilename, const std::string &gamesCollectionFilename)
+        : sharedData(sharedData),
+          snapshotFilename(accountsFilename + ".snapshot"),
+          sourceFilenames{accountsFilename, availableGamesFilename, gamesCollectionFilename}
+    {
+        sharedData.setLoadedFromSnapshot(load());
+    }
+
+    // Function to write the current SharedData as the snapshot of the master files as they are now
+    // Must only be called while the in-memory state matches the master files
+    bool save()
+    {
+        SnapshotHeader header = {};
+        std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+        header.version = snapshotVersion;
+        header.byteOrderMark = snapshotByteOrderMark;
+        header.sourceHash = hashSourceFiles();
+
+        std::vector<SnapshotUser> users;
+        std::vector<SnapshotOwnedGame> ownedGames;
+        for (const User &user : sharedData.getUsers())
+        {
+            SnapshotUser snapshotUser = {};
+            if (!copyName(snapshotUser.username, user.getUsername()))
+                return false;
+            snapshotUser.type = user.getType();
+            snapshotUser.credit = user.getCredit();
+            std::vector<std::string> gameNames = user.getGameNames();
+            snapshotUser.ownedGameCount = static_cast<uint32_t>(gameNames.size());
+            users.push_back(snapshotUser);
+
+            for (const std::string &gameName : gameNames)
+            {
+                SnapshotOwnedGame ownedGame = {};
+                if (!copyName(ownedGame.gameName, gameName))
+                    return false;
+                ownedGames.push_back(ownedGame);
+            }
+        }
+
+        // Listings made this run are part of the available games file from the next run on
+        std::vector<SnapshotGame> games;
+        for (const std::vector<Game> *gameList : {&sharedData.getAvailableGames(), &sharedData.getPendingListings()})
+        {
+            for (const Game &game : *gameList)
+            {
+                SnapshotGame snapshotGame = {};
+                if (!copyName(snapshotGame.gameName, game.getGameName()) || !copyName(snapshotGame.sellerName, game.getSellerName()))
+                    return false;
+                snapshotGame.price = game.getPrice();
+                games.push_back(snapshotGame);
+            }
+        }
+
+        std::vector<SnapshotIndexEntry> collectionIndex;
+        if (!flattenIndex(sharedData.getCollectionIndex(), collectionIndex))
+            return false;
+
+        header.userCount = users.size();
+        header.ownedGameCount = ownedGames.size();
+        header.gameCount = games.size();
+        header.collectionIndexCount = collectionIndex.size();
+
+        // Write to a temp file and rename it in so a reader never maps a half-written snapshot
+        std::string tempFilename = snapshotFilename + "." + std::to_string(getpid()) + ".tmp";
+        std::ofstream snapshotFile(tempFilename, std::ios::binary | std::ios::trunc);
+        if (!snapshotFile.is_open())
+        {
+            std::cerr << "Error: Unable to create the snapshot file." << std::endl;
+            return false;
+        }
+
+        snapshotFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        writeRecords(snapshotFile, users);
+        writeRecords(snapshotFile, ownedGames);
+        writeRecords(snapshotFile, games);
+        writeRecords(snapshotFile, collectionIndex);
+        snapshotFile.close();
+
+        if (snapshotFile.fail() || std::rename(tempFilename.c_str(), snapshotFilename.c_str()) != 0)
+        {
+            std::cerr << "Error: Unable to write the snapshot file." << std::endl;
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    // Function to delete the snapshot so the next start parses the master files
+    void discard()
+    {
+        std::remove(snapshotFilename.c_str());
+    }
+
+private:
+    // Reference to the shared data object
+    SharedData &sharedData;
+
+    // Filename of the snapshot and of the master files it mirrors
+    std::string snapshotFilename;
+    std::string sourceFilenames[3];
+
+    uint64_t hashSourceFiles() const
+    {
+        uint64_t hash = fnvOffsetBasis;
+        for (const std::string &filename : sourceFilenames)
+            hash = hashFile(filename, hash);
+        return hash;
+    }
+
+    // Function to map the snapshot and fill SharedData from it
+    // Returns false, leaving SharedData untouched, if the snapshot is missing, stale or malformed
+    bool load()
+    {
+        MappedFile snapshot(snapshotFilename);
+        if (!snapshot.isOpen() || snapshot.size() < sizeof(SnapshotHeader))
+            return false;
+
+        SnapshotHeader header;
+        std::memcpy(&header, snapshot.data(), sizeof(header));
+        if (std::memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0 ||
+            header.version != snapshotVersion || header.byteOrderMark != snapshotByteOrderMark)
+            return false;
+
+        // The master files changed since the snapshot was taken
+        if (header.sourceHash != hashSourceFiles())
+            return false;
+
+        // Reject counts that do not add up to exactly the file size
+        uint64_t counts[] = {header.userCount, header.ownedGameCount, header.gameCount, header.collectionIndexCount};
+        for (uint64_t count : counts)
+        {
+            if (count > snapshot.size())
+                return false;
+        }
+        uint64_t expectedSize = sizeof(SnapshotHeader) +
+                                header.userCount * sizeof(SnapshotUser) +
+                                header.ownedGameCount * sizeof(SnapshotOwnedGame) +
+                                header.gameCount * sizeof(SnapshotGame) +
+                                header.collectionIndexCount * sizeof(SnapshotIndexEntry);
+        if (expectedSize != snapshot.size())
+            return false;
+
+        const char *cursor = snapshot.data() + sizeof(SnapshotHeader);
+        const SnapshotUser *users = advance<SnapshotUser>(cursor, header.userCount);
+        const SnapshotOwnedGame *ownedGames = advance<SnapshotOwnedGame>(cursor, header.ownedGameCount);
+        const SnapshotGame *games = advance<SnapshotGame>(cursor, header.gameCount);
+        const SnapshotIndexEntry *collectionEntries = advance<SnapshotIndexEntry>(cursor, header.collectionIndexCount);
+
+        std::vector<User> loadedUsers;
+        loadedUsers.reserve(header.userCount);
+        uint64_t ownedGameIndex = 0;
+        for (uint64_t i = 0; i < header.userCount; i++)
+        {
+            if (header.ownedGameCount - ownedGameIndex < users[i].ownedGameCount)
+                return false;
+
+            loadedUsers.push_back(User(readName(users[i].username), users[i].type, users[i].credit));
+            for (uint32_t j = 0; j < users[i].ownedGameCount; j++)
+                loadedUsers.back().addGameToCollection(readName(ownedGames[ownedGameIndex++].gameName));
+        }
+
+        std::vector<Game> loadedGames;
+        loadedGames.reserve(header.gameCount);
+        for (uint64_t i = 0; i < header.gameCount; i++)
+            loadedGames.push_back(Game(readName(games[i].gameName), readName(games[i].sellerName), games[i].price));
+
+        sharedData.getUsers() = std::move(loadedUsers);
+        sharedData.getAvailableGames() = std::move(loadedGames);
+        sharedData.getStoreIndex().rebuild(sharedData.getAvailableGames());
+        sharedData.getCollectionIndex() = buildIndex(collectionEntries, header.collectionIndexCount);
+
+        return true;
+    }
+
+    template <typename Record>
+    static const Record *advance(const char *&cursor, uint64_t count)
+    {
+        const Record *records = reinterpret_cast<const Record *>(cursor);
+        cursor += count * sizeof(Record);
+        return records;
+    }
+
+    template <typename Record>
+    static void writeRecords(std::ofstream &file, const std::vector<Record> &records)
+    {
+        if (!records.empty())
+            file.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(Record));
+    }
+
+    static bool copyName(char *destination, const std::string &name)
+    {
+        if (name.length() >= snapshotNameLength)
+            return false;
+
+        std::memcpy(destination, name.data(), name.length());
+        return true;
+    }
+
+    static std::string readName(const char *source)
+    {
+        return std::string(source, strnlen(source, snapshotNameLength));
+    }
+
+    static bool flattenIndex(const RecordIndex &index, std::vector<SnapshotIndexEntry> &entries)
+    {
+        for (const auto &userRecords : index)
+        {
+            for (std::streamoff offset : userRecords.second)
+            {
+                SnapshotIndexEntry entry = {};
+                if (!copyName(entry.username, userRecords.first))
+                    return false;
+                entry.offset = offset;
+                entries.push_back(entry);
+            }
+        }
+        return true;
+    }
+
+    static RecordIndex buildIndex(const SnapshotIndexEntry *entries, uint64_t count)
+    {
+        RecordIndex index;
+        for (uint64_t i = 0; i < count; i++)
+            index[readName(entries[i].username)].push_back(entries[i].offset);
+        return index;
+    }
+};
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef STATE_HISTORY_H
+#define STATE_HISTORY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "FixedDecimal.h"
+#include "PersistentMap.h"
+#include "SharedData.h"
+
+// An account as it stood at the end of a day
+struct HistoricalAccount
+{
+    int type;
+    int64_t creditCents;
+
+    bool operator==(const HistoricalAccount &other) const
+    {
+        return type == other.type && creditCents == other.creditCents;
+    }
+};
+
+// The (seller, price in cents) listings of one game, sorted by seller
+typedef std::vector<std::pair<std::string, int64_t>> HistoricalListings;
+
+// The accounts and the catalog at the end of one day
+struct DayState
+{
+    PersistentMap<HistoricalAccount> accounts;
+    PersistentMap<HistoricalListings> listings;
+};
+
+// Function to get today's date as YYYY-MM-DD in local time
+inline std::string getCurrentDate()
+{
+    std::time_t now = std::time(nullptr);
+    char date[16];
+    std::strftime(date, sizeof(date), "%Y-%m-%d", std::localtime(&now));
+    return date;
+}
+
+// Function to check that text is a date written as YYYY-MM-DD
+inline bool isHistoryDate(const std::string &text)
+{
+    if (text.length() != 10 || text[4] != '-' || text[7] != '-')
+        return false;
+    for (size_t i = 0; i < text.length(); i++)
+    {
+        if (i != 4 && i != 7 && (text[i] < '0' || text[i] > '9'))
+            return false;
+    }
+    return true;
+}
+
+// End-of-day versions of the accounts and the catalog, kept as persistent maps ("<accounts file>.history")
+class StateHistory
+{
+public:
+    // Constructor that loads the history kept for the given accounts file
+    StateHistory(const std::string &accountsFilename)
+        : historyFilename(accountsFilename + ".history")
+    {
+        load();
+    }
+
+    // Function to record the current state as the end of the given day
+    void capture(SharedData &sharedData, const std::string &date)
+    {
+        DayState state = days.empty() ? DayState() : days.rbegin()->second;
+        std::ostringstream changes;
+
+        std::unordered_set<std::string> usernames;
+        for (const User &user : sharedData.getUsers())
+        {
+            usernames.insert(user.getUsername());
+            HistoricalAccount account{user.getType(), amountToCents(user.getCredit())};
+            const HistoricalAccount *previous = state.accounts.find(user.getUsername());
+            if (previous == nullptr || !(*previous == account))
+            {
+                state.accounts = state.accounts.set(user.getUsername(), account);
+                changes << "A " << account.creditCents << ' ' << account.type << ' ' << user.getUsername() << '\n';
+            }
+        }
+        std::vector<std::string> deletedUsernames;
+        state.accounts.forEach([&usernames, &deletedUsernames](const std::string &username, const HistoricalAccount &)
+                               {
+                                   if (usernames.count(username) == 0)
+                                       deletedUsernames.push_back(username);
+                               });
+        for (const std::string &username : deletedUsernames)
+        {
+            state.accounts = state.accounts.erase(username);
+            changes << "X " << username << '\n';
+        }
+
+        std::map<std::string, HistoricalListings> catalog;
+        for (const std::vector<Game> *games : {&sharedData.getAvailableGames(), &sharedData.getPendingListings()})
+        {
+            for (const Game &game : *games)
+                catalog[game.getGameName()].push_back(std::make_pair(game.getSellerName(), amountToCents(game.getPrice())));
+        }
+        for (auto &game : catalog)
+        {
+            std::sort(game.second.begin(), game.second.end());
+            const HistoricalListings *previous = state.listings.find(game.first);
+            if (previous != nullptr && *previous == game.second)
+                continue;
+
+            state.listings = state.listings.set(game.first, game.second);
+            changes << "G " << game.first << '\n';
+            for (const auto &listing : game.second)
+                changes << "S " << listing.second << ' ' << listing.first << '\n';
+        }
+        std::vector<std::string> delistedGames;
+        state.listings.forEach([&catalog, &delistedGames](const std::string &gameName, const HistoricalListings &)
+                               {
+                                   if (catalog.count(gameName) == 0)
+                                       delistedGames.push_back(gameName);
+                               });
+        for (const std::string &gameName : delistedGames)
+        {
+            state.listings = state.listings.erase(gameName);
+            changes << "G " << gameName << '\n';
+        }
+
+        // A clock set back still records after the last day
+        std::string day = days.empty() ? date : std::max(date, days.rbegin()->first);
+        days[day] = state;
+        lastCaptureDate = day;
+
+        if (changes.tellp() == 0)
+            return;
+
+        std::ofstream historyFile(historyFilename, std::ios::app);
+        historyFile << "D " << day << '\n'
+                    << changes.str() << "E" << '\n';
+        if (historyFile.fail())
+            std::cerr << "Error: Unable to write the state history." << std::endl;
+    }
+
+    // Function to capture the state under the last captured day if the date has moved on since
+    void captureIfDayEnded(SharedData &sharedData)
+    {
+        std::string today = getCurrentDate();
+        if (!lastCaptureDate.empty() && today > lastCaptureDate)
+            capture(sharedData, lastCaptureDate);
+        lastCaptureDate = std::max(lastCaptureDate, today);
+    }
+
+    // Function to get the state at the end of a day, or nullptr if nothing was recorded by then
+    const DayState *getDayState(const std::string &date) const
+    {
+        auto after = days.upper_bound(date);
+        if (after == days.begin())
+            return nullptr;
+        return &std::prev(after)->second;
+    }
+
+private:
+    std::string historyFilename;
+
+    // End-of-day states by date
+    std::map<std::string, DayState> days;
+
+    std::string lastCaptureDate;
+
+    // Function to replay the history file into the versions
+    // Format: "D <date>", then "A <credit cents> <type> <username>", "X <username>" for a deleted account,
+    // "G <game name>" followed by its "S <price cents> <seller>" listings (none if delisted), then "E"
+    void load()
+    {
+        std::ifstream historyFile(historyFilename);
+        if (!historyFile.is_open())
+            return;
+
+        std::string line;
+        std::string date;
+        std::string gameName;
+        DayState state;
+        HistoricalListings listings;
+        bool inBlock = false;
+        bool valid = true;
+        while (valid && std::getline(historyFile, line))
+        {
+            if (line.length() < 1 || (line.length() > 1 && line[1] != ' '))
+            {
+                valid = false;
+                break;
+            }
+
+            std::string rest = line.length() > 2 ? line.substr(2) : "";
+            std::istringstream fields(rest);
+            char tag = line[0];
+            if (tag == 'D' && isHistoryDate(rest))
+            {
+                // A block still open here was cut short by an interrupted capture and is dropped
+                date = rest;
+                state = days.empty() ? DayState() : days.rbegin()->second;
+                gameName.clear();
+                inBlock = true;
+            }
+            else if (tag == 'A' && inBlock)
+            {
+                HistoricalAccount account;
+                std::string username;
+                valid = fields >> account.creditCents >> account.type && fields.get() == ' ' && std::getline(fields, username);
+                if (valid)
+                    state.accounts = state.accounts.set(username, account);
+            }
+            else if (tag == 'X' && inBlock && !rest.empty())
+            {
+                state.accounts = state.accounts.erase(rest);
+            }
+            else if ((tag == 'G' || tag == 'E') && inBlock)
+            {
+                if (!gameName.empty())
+                    state.listings = listings.empty() ? state.listings.erase(gameName) : state.listings.set(gameName, listings);
+                gameName = tag == 'G' ? rest : "";
+                listings.clear();
+                valid = tag == 'E' || !gameName.empty();
+
+                if (tag == 'E')
+                {
+                    days[date] = state;
+                    inBlock = false;
+                }
+            }
+            else if (tag == 'S' && inBlock && !gameName.empty())
+            {
+                std::pair<std::string, int64_t> listing;
+                valid = static_cast<bool>(fields >> listing.second >> listing.first);
+                if (valid)
+                    listings.push_back(listing);
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+
+        if (!valid)
+            std::cerr << "Error: Damaged state history. Keeping the days before the damage." << std::endl;
+    }
+};
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef STORE_INDEX_H
+#define STORE_INDEX_H
+
+#include <cstdint>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Game.h"
+#include "FixedDecimal.h"
+#include "GameSearchIndex.h"
+#include "PageCursor.h"
+
+// Orders in which the store listing can be served
+enum StoreSortOrder
+{
+    SortByName,
+    SortByPrice,
+    SortBySeller,
+    StoreSortOrderCount
+};
+
+// A listing as held by the store indexes
+struct StoreEntry
+{
+    std::string gameName;
+    std::string sellerUsername;
+    int64_t priceCents;
+};
+
+// Comparison of store entries in one order; the other fields break ties so the order is total
+struct StoreEntryLess
+{
+    StoreSortOrder order;
+
+    bool operator()(const StoreEntry &left, const StoreEntry &right) const
+    {
+        if (order == SortByPrice)
+            return std::tie(left.priceCents, left.gameName, left.sellerUsername) <
+                   std::tie(right.priceCents, right.gameName, right.sellerUsername);
+        if (order == SortBySeller)
+            return std::tie(left.sellerUsername, left.gameName, left.priceCents) <
+                   std::tie(right.sellerUsername, right.gameName, right.priceCents);
+        return std::tie(left.gameName, left.sellerUsername, left.priceCents) <
+               std::tie(right.gameName, right.sellerUsername, right.priceCents);
+    }
+};
+
+typedef std::multiset<StoreEntry, StoreEntryLess> StoreOrderIndex;
+
+// Ordered indexes over the available games, one per StoreSortOrder, and a trigram index over their names
+class StoreIndex
+{
+public:
+    StoreIndex()
+        : indexes{StoreOrderIndex(StoreEntryLess{SortByName}),
+                  StoreOrderIndex(StoreEntryLess{SortByPrice}),
+                  StoreOrderIndex(StoreEntryLess{SortBySeller})} {}
+
+    // Function to replace the indexes with ones over the given games
+    void rebuild(const std::vector<Game> &games)
+    {
+        for (StoreOrderIndex &index : indexes)
+            index.clear();
+        searchIndex.clear();
+        for (const Game &game : games)
+            add(game);
+    }
+
+    // Function to add a listing to every index
+    void add(const Game &game)
+    {
+        StoreEntry entry = {game.getGameName(), game.getSellerName(), amountToCents(game.getPrice())};
+        for (StoreOrderIndex &index : indexes)
+            index.insert(entry);
+        searchIndex.add(entry.gameName);
+    }
+
+    // Function to remove every listing of a seller from every index
+    void removeSeller(const std::string &sellerUsername)
+    {
+        StoreOrderIndex &bySeller = indexes[SortBySeller];
+        auto first = bySeller.lower_bound(StoreEntry{"", sellerUsername, INT64_MIN});
+        auto last = first;
+        for (; last != bySeller.end() && last->sellerUsername == sellerUsername; ++last)
+        {
+            eraseOne(indexes[SortByName], *last);
+            eraseOne(indexes[SortByPrice], *last);
+            searchIndex.remove(last->gameName);
+        }
+        bySeller.erase(first, last);
+    }
+
+    // Function to get the index serving one order
+    const StoreOrderIndex &getIndex(StoreSortOrder order) const
+    {
+        return indexes[order];
+    }
+
+    // Function to get the trigram index over the listed game names
+    const GameSearchIndex &getSearchIndex() const
+    {
+        return searchIndex;
+    }
+
+private:
+    StoreOrderIndex indexes[StoreSortOrderCount];
+    GameSearchIndex searchIndex;
+
+    static void eraseOne(StoreOrderIndex &index, const StoreEntry &entry)
+    {
+        auto found = index.find(entry);
+        if (found != index.end())
+            index.erase(found);
+    }
+};
+
+// Options of a filtered, paged store listing, parsed from the arguments after "list"
+struct StoreQuery
+{
+    StoreSortOrder order = SortByName;
+    int64_t minPriceCents = 0;
+    int64_t maxPriceCents = INT64_MAX;
+    std::string sellerUsername;
+    size_t pageSize = 50;
+    size_t page = 1;
+    bool hasCursor = false;
+    StoreEntry cursor = {"", "", 0};
+};
+
+// Function to encode the position of a listing as a token that can be typed back on one line
+inline std::string encodeStoreCursor(const StoreEntry &entry)
+{
+    return encodePageCursor(entry.gameName + '\x1f' + entry.sellerUsername + '\x1f' + std::to_string(entry.priceCents));
+}
+
+// Function to decode a token made by encodeStoreCursor; returns false if it is malformed
+inline bool decodeStoreCursor(const std::string &cursor, StoreEntry &entry)
+{
+    std::string plain;
+    if (!decodePageCursor(cursor, plain))
+        return false;
+
+    size_t first = plain.find('\x1f');
+    size_t second = first == std::string::npos ? std::string::npos : plain.find('\x1f', first + 1);
+    size_t priceCents;
+    if (second == std::string::npos || !parseCount(plain.substr(second + 1), 0, 999999999, priceCents))
+        return false;
+
+    entry.gameName = plain.substr(0, first);
+    entry.sellerUsername = plain.substr(first + 1, second - first - 1);
+    entry.priceCents = static_cast<int64_t>(priceCents);
+    return true;
+}
+
+// Function to parse "sort=name|price|seller min=<price> max=<price> seller=<name> limit=<n> page=<n> after=<cursor>"
+// Returns an error message, or "" if every argument is valid
+inline std::string parseStoreQuery(const std::string &arguments, StoreQuery &query)
+{
+    std::istringstream argumentStream(arguments);
+    std::string argument;
+    while (argumentStream >> argument)
+    {
+        size_t equals = argument.find('=');
+        std::string name = argument.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+        if (value.empty())
+            return "Missing value for " + name;
+
+        if (name == "sort")
+        {
+            if (value == "name")
+                query.order = SortByName;
+            else if (value == "price")
+                query.order = SortByPrice;
+            else if (value == "seller")
+                query.order = SortBySeller;
+            else
+                return "Unknown sort order " + value;
+        }
+        else if (name == "min" || name == "max")
+        {
+            if (!parseDecimalCents(value, name == "min" ? query.minPriceCents : query.maxPriceCents))
+                return "Invalid price " + value;
+        }
+        else if (name == "seller")
+        {
+            query.sellerUsername = value;
+        }
+        else if (name == "limit" || name == "page")
+        {
+            if (!parseCount(value, 1, name == "limit" ? 10000 : 100000000, name == "limit" ? query.pageSize : query.page))
+                return "Invalid " + name + " " + value;
+        }
+        else if (name == "after")
+        {
+            if (!decodeStoreCursor(value, query.cursor))
+                return "Invalid cursor " + value;
+            query.hasCursor = true;
+        }
+        else
+        {
+            return "Unknown list option " + name;
+        }
+    }
+    return "";
+}
+
+#endif
@@ -2,12 +2,27 @@
 #define TRANSACTION_HANDLER_H
 
 #include <iostream>
+#include <mutex>
 #include <string>
 #include "AuthManager.h"
 #include "UserManager.h"
 #include "GameManager.h"
 #include "SharedData.h"
+#include "Compactor.h"
+#include "SnapshotStore.h"
+#include "MasterFileWatcher.h"
+#include "Options.h"
+#include "TransactionTable.h"
 #include "DailyTransactionWriter.h"
+#include "PurchaseHistory.h"
+#include "SellerRevenue.h"
+#include "TransactionSketches.h"
+#include "CoPurchaseIndex.h"
+#include "VelocityGuard.h"
+#include "StateHistory.h"
+#include "ChangeFeedServer.h"
+#include "ReplicationFollower.h"
+#include "ShardRouter.h"
 
 class TransactionHandler
 {
@@ -15,37 +30,169 @@ public:
     // Constructor that takes a SharedData reference and filenames for various data
     TransactionHandler(SharedData &sharedData, const std::string &usersFilename,
                        const std::string &availableGamesFilename, const std::string gamesCollectionFilename,
-                       const std::string &dailyTransactionFilename)
+                       const std::string &dailyTransactionFilename, const Options &options = Options())
         : sharedData(sharedData),
-          userManager(sharedData, usersFilename),
+          options(options),
+          changeLogFilename(usersFilename + ".changes"),
+          isFollower(!options.leaderSocketPath.empty()),
+          shardRouter(options.shardCount, usersFilename, gamesCollectionFilename),
+          snapshotStore(sharedData, usersFilename, availableGamesFilename, gamesCollectionFilename),
+          compactor(sharedData, usersFilename, availableGamesFilename, gamesCollectionFilename, shardRouter),
+          userManager(sharedData, usersFilename, compactor, options),
           authManager(sharedData, usersFilename),
-          gameManager(sharedData, usersFilename, availableGamesFilename, gamesCollectionFilename),
-          dailyTransactionWriter(dailyTransactionFilename) {}
+          gameManager(sharedData, availableGamesFilename, gamesCollectionFilename, compactor, options),
+          dailyTransactionWriter(dailyTransactionFilename),
+          purchaseHistory(dailyTransactionFilename),
+          sellerRevenue(dailyTransactionFilename),
+          transactionSketches(dailyTransactionFilename),
+          coPurchaseIndex(gamesCollectionFilename),
+          velocityGuard(options.velocityRulesFilename, dailyTransactionFilename + ".flags", dailyTransactionFilename + ".velocity"),
+          stateHistory(usersFilename),
+          changeFeedServer(sharedData.getChangeFeed()),
+          masterFileWatcher(sharedData, compactor, snapshotStore, usersFilename, availableGamesFilename),
+          replicationFollower(sharedData, options.leaderSocketPath)
+    {
+        dailyTransactionWriter.addObserver(purchaseHistory);
+        dailyTransactionWriter.addObserver(sellerRevenue);
+        dailyTransactionWriter.addObserver(transactionSketches);
+        if (options.binaryJournal)
+            dailyTransactionWriter.openBinaryJournal(dailyTransactionFilename + ".bin");
+        changeFeedServer.setSnapshotSource([this](uint64_t &sequence)
+                                           { return buildReplicationSnapshot(sequence); });
+
+        // A follower's state is the leader's; it writes none of its own files until promoted
+        if (isFollower)
+        {
+            replicationFollower.start();
+            return;
+        }
+
+        // A master file was refused; nothing is written, so compaction cannot replace it with the partial state
+        if (sharedData.isLoadFailed())
+            return;
+
+        // The master files were parsed, so refresh the snapshot for the next start
+        if (!sharedData.isLoadedFromSnapshot())
+            snapshotStore.save();
+
+        // Everything is loaded; fold in deltas from an interrupted run and start background compaction
+        compactor.start();
+        stateHistory.capture(sharedData, getCurrentDate());
+
+        if (options.changeFeed && sharedData.getChangeFeed().open(changeLogFilename))
+            changeFeedServer.start();
+
+        if (options.watchMasterFiles)
+            masterFileWatcher.start();
+    }
+
+    // Destructor that flushes the master files and leaves a snapshot of them for a warm start
+    ~TransactionHandler()
+    {
+        replicationFollower.stop();
+        if (isFollower || sharedData.isLoadFailed())
+            return;
+
+        // A run that crossed midnight closes the day it started in before recording today's state
+        stateHistory.captureIfDayEnded(sharedData);
+        stateHistory.capture(sharedData, getCurrentDate());
+        masterFileWatcher.stop();
+        compactor.stop();
+
+        if (!compactor.isClean() || !snapshotStore.save())
+            snapshotStore.discard();
+    }
 
     // Function to handle different transactions based on the provided transaction code
     void handleTransaction(const std::string &transactionCode)
     {
-        if (transactionCode == "login")
+        int currentUserType;
         {
-            handleLoginTransaction();
+            std::lock_guard<std::mutex> lock(sharedData.getMutex());
+            if (!isFollower)
+                stateHistory.captureIfDayEnded(sharedData);
+            currentUserType = sharedData.getCurrentUser().getType();
+        }
+
+        const TransactionDescriptor *transaction = findTransaction(transactionCode);
+
+        if (transaction != nullptr && !transaction->requiresLogin)
+        {
+            runTransaction(*transaction);
         }
         else if (!isLoggedIn)
         {
             std::cout << "You must login first" << std::endl;
         }
+        else if (transaction == nullptr)
+        {
+            std::cout << "Invalid transaction code. Please try again." << std::endl;
+        }
+        else if ((transaction->allowedRoles & roleBit(currentUserType)) == 0)
+        {
+            std::cout << transaction->deniedMessage << std::endl;
+        }
         else
         {
-            handleLoggedInTransaction(transactionCode);
+            runTransaction(*transaction);
         }
     }
 
+    // Entry of the dispatch table: everything needed to authorize and run one transaction code
+    struct TransactionDescriptor
+    {
+        const char *code;
+        bool requiresLogin;
+        unsigned allowedRoles;
+        const char *deniedMessage;
+        Durability durability;
+        void (TransactionHandler::*handler)();
+    };
+
+    // Dispatch table, one entry per transaction code; add new transactions here
+    static const TransactionDescriptor transactions[];
+
+    // Perfect hash over the codes in the dispatch table
+    static constexpr size_t transactionSlotCount = 32;
+    static const PerfectHashTable<transactionSlotCount> transactionSlots;
+
+    // Function to look up the descriptor of a transaction code, or nullptr if there is none
+    static const TransactionDescriptor *findTransaction(const std::string &transactionCode)
+    {
+        int index = transactionSlots.find(transactionCode);
+        if (index < 0 || transactionCode != transactions[index].code)
+            return nullptr;
+
+        return &transactions[index];
+    }
+
 private:
     // Variable to track whether a user is logged in
     bool isLoggedIn = false;
 
+    // Number of games the "recommend" transaction shows
+    static constexpr size_t maxRecommendations = 10;
+
     // Reference to the shared data object
     SharedData &sharedData;
 
+    // Flags the handler was started with, for what a promotion turns on
+    Options options;
+    std::string changeLogFilename;
+
+    // Whether this instance is a read-only replica of a leader (--follow)
+    bool isFollower;
+
+    // ShardRouter instance partitioning the accounts and collections across shard files when --shards is given;
+    // it comes first so an interrupted sharded run is folded back into the master files before they load
+    ShardRouter shardRouter;
+
+    // SnapshotStore instance that restores the shared data without parsing unchanged master files
+    SnapshotStore snapshotStore;
+
+    // Compactor instance that persists changes to the master files in the background
+    Compactor compactor;
+
     // AuthManager, UserManager, and GameManager instances for handling transactions
     AuthManager authManager;
     UserManager userManager;
@@ -54,67 +201,151 @@ private:
     // DailyTransactionWriter instance for recording daily transactions
     DailyTransactionWriter dailyTransactionWriter;
 
-    // Helper function to handle the "login" transaction
-    void handleLoginTransaction()
-    {
-        if (isLoggedIn)
-        {
-            std::cout << "You are already logged in" << std::endl;
-        }
-        else
-        {
-            isLoggedIn = authManager.login();
-        }
-    }
+    // PurchaseHistory instance indexing the purchases in the daily transaction file to check refunds against
+    PurchaseHistory purchaseHistory;
+
+    // SellerRevenue instance keeping the sales totals and ranking of every seller
+    SellerRevenue sellerRevenue;
 
-    // Helper function to handle transactions when the user is already logged in
-    void handleLoggedInTransaction(const std::string &transactionCode)
+    // TransactionSketches instance estimating distinct buyers, games and users from the log
+    TransactionSketches transactionSketches;
+
+    // CoPurchaseIndex instance counting which games are owned together, for recommendations
+    CoPurchaseIndex coPurchaseIndex;
+
+    // VelocityGuard instance holding refunds and credit grants to the configured sliding-window limits
+    VelocityGuard velocityGuard;
+
+    // StateHistory instance keeping end-of-day versions of the accounts and the catalog
+    StateHistory stateHistory;
+
+    // ChangeFeedServer instance streaming the change log to consumers when --change-feed is given
+    ChangeFeedServer changeFeedServer;
+
+    // MasterFileWatcher instance that picks up external edits to the master files when --watch is given
+    MasterFileWatcher masterFileWatcher;
+
+    // ReplicationFollower instance keeping the shared data a replica of the leader's when --follow is given
+    ReplicationFollower replicationFollower;
+
+    // Function to run the handler of a transaction
+    // Handlers read their input without the SharedData mutex and take it only to look at or change the shared data
+    void runTransaction(const TransactionDescriptor &transaction)
     {
-        if (transactionCode == "logout")
+        if (isFollower && transaction.durability == MasterDurable)
         {
-            handleLogoutTransaction();
+            std::cout << "This instance is a read-only follower." << std::endl;
+            return;
         }
-        else if (transactionCode == "sell")
-        {
-            handleSellTransaction();
-        }
-        else if (transactionCode == "buy")
-        {
-            handleBuyTransaction();
-        }
-        else if (transactionCode == "create")
+
+        // Memory holds a transfer the files could not be given, so nothing more can be saved
+        if (transaction.durability == MasterDurable && compactor.hasFailed())
         {
-            handleCreateTransaction();
+            std::cout << "Changes can no longer be saved. Please restart the program." << std::endl;
+            return;
         }
-        else if (transactionCode == "delete")
+
+        (this->*transaction.handler)();
+
+        if (transaction.durability == SessionDurable)
         {
-            handleDeleteTransaction();
+            std::lock_guard<std::mutex> lock(sharedData.getMutex());
+            sharedData.getAccountIndex().invalidate();
+            sharedData.getChangeFeed().publish();
         }
-        else if (transactionCode == "refund")
+    }
+
+    // Function to change the shared data under its mutex, append the journal lines as one transfer,
+    // drop the sorted user views the change may have outdated and publish it
+    // apply returns whether it changed anything; this function returns whether it did and the change was saved
+    template <typename Apply>
+    bool applyChanges(Apply apply)
+    {
+        std::lock_guard<std::mutex> lock(sharedData.getMutex());
+        compactor.beginTransfer();
+        bool changed = apply();
+        bool saved = compactor.commitTransfer() && !compactor.hasFailed();
+
+        sharedData.getAccountIndex().invalidate();
+        if (changed && !saved)
         {
-            handleRefundTransaction();
+            // Consumers must not see a change the files do not hold
+            sharedData.getChangeFeed().discard();
+            std::cout << "Error: The transaction was not saved. Changes can no longer be saved. Please restart the program."
+                      << std::endl;
+            return false;
         }
-        else if (transactionCode == "addcredit")
+
+        sharedData.getChangeFeed().publish();
+        return changed;
+    }
+
+    // Helper function to handle the "login" transaction
+    void handleLoginTransaction()
+    {
+        if (isLoggedIn)
         {
-            handleAddCreditTransaction();
+            std::cout << "You are already logged in" << std::endl;
         }
-        else if (transactionCode == "list")
+        else
         {
-            handleListTransaction();
+            isLoggedIn = authManager.login();
         }
-        else if (transactionCode == "listusers")
+    }
+
+    // Function to build the snapshot a new replica starts from: one line per account ("A"),
+    // buyable listing ("L"), listing made this run ("P") and owned game ("O"), as the master files hold them
+    std::string buildReplicationSnapshot(uint64_t &sequence)
+    {
+        std::lock_guard<std::mutex> lock(sharedData.getMutex());
+        std::string snapshot;
+        for (const User &user : sharedData.getUsers())
+            snapshot.append("A ").append(UserUpdater::formatUser(user)).push_back('\n');
+        for (const Game &game : sharedData.getAvailableGames())
+            snapshot.append("L ").append(GameUpdater::formatAvailableGame(game)).push_back('\n');
+        for (const Game &game : sharedData.getPendingListings())
+            snapshot.append("P ").append(GameUpdater::formatAvailableGame(game)).push_back('\n');
+        for (const User &user : sharedData.getUsers())
         {
-            handleListUsersTransaction();
+            for (const std::string &gameName : user.getGameNames())
+                snapshot.append("O ").append(GameUpdater::formatCollectionEntry(gameName, user.getUsername())).push_back('\n');
         }
-        else
+
+        // Holding the mutex, no transaction is between reporting its changes and publishing them
+        sequence = sharedData.getChangeFeed().getLastSequence();
+        return snapshot;
+    }
+
+    // Helper function to handle the "promote" transaction
+    void handlePromoteTransaction()
+    {
+        if (!isFollower)
         {
-            std::cout << "Invalid transaction code. Please try again." << std::endl;
+            std::cout << "This instance is already the leader." << std::endl;
+            return;
         }
+
+        // Stop following first so no event lands after the state is written out
+        replicationFollower.stop();
+        isFollower = false;
+
+        std::lock_guard<std::mutex> lock(sharedData.getMutex());
+        compactor.adoptState();
+        stateHistory.capture(sharedData, getCurrentDate());
+
+        // Number the new leader's changes on from the last one replicated, so consumers can switch over
+        if (options.changeFeed && sharedData.getChangeFeed().open(changeLogFilename, replicationFollower.getAppliedSequence()))
+            changeFeedServer.start();
+        if (options.watchMasterFiles)
+            masterFileWatcher.start();
+
+        std::cout << "Promoted to leader after change " << replicationFollower.getAppliedSequence() << "." << std::endl;
     }
 
     // Helper function to handle the "logout" transaction
     void handleLogoutTransaction()
     {
+        std::lock_guard<std::mutex> lock(sharedData.getMutex());
         dailyTransactionWriter.writeDailyTransactionFile(sharedData.getCurrentUser());
         isLoggedIn = !authManager.logout();
     }
@@ -122,130 +353,489 @@ private:
     // Helper function to handle the "sell" transaction
     void handleSellTransaction()
     {
-        if (sharedData.getCurrentUser().getType() == BuyStandard)
-        {
-            std::cout << "You do not have the privilege to sell a game." << std::endl;
-        }
-        else
-        {
-            Game game = gameManager.sellGame();
+        std::string gameName;
+        double price;
+        if (!gameManager.promptSellGame(gameName, price))
+            return;
 
-            if (game.getGameName() == "")
-                return;
+        Game game("", "", 0.0);
+        if (!applyChanges([this, &game, &gameName, price]()
+                          {
+                              game = gameManager.sellGame(gameName, price);
+                              return game.getGameName() != "";
+                          }))
+            return;
 
-            dailyTransactionWriter.addSellTransaction(game);
-        }
+        std::cout << "Game listed for sale." << std::endl;
+        dailyTransactionWriter.addSellTransaction(game);
     }
 
     // Helper function to handle the "buy" transaction
     void handleBuyTransaction()
     {
-        if (sharedData.getCurrentUser().getType() == SellStandard)
-        {
-            std::cout << "You do not have the privilege to sell a game." << std::endl;
-        }
-        else
-        {
-            Game game = gameManager.buyGame();
+        std::string gameName;
+        std::string sellerUsername;
+        if (!gameManager.promptBuyGame(gameName, sellerUsername))
+            return;
+
+        Game game("", "", 0.0);
+        std::string buyerUsername;
+        std::vector<std::string> ownedGameNames;
+        if (!applyChanges([this, &game, &gameName, &sellerUsername, &buyerUsername, &ownedGameNames]()
+                          {
+                              game = gameManager.buyGame(gameName, sellerUsername);
+                              buyerUsername = sharedData.getCurrentUser().getUsername();
+                              ownedGameNames = sharedData.getCurrentUser().getGameNames();
+                              return game.getGameName() != "";
+                          }))
+            return;
 
-            // If buy game failed
-            if (game.getGameName() == "")
-                return;
+        std::cout << "Game purchased successfully." << std::endl;
+        dailyTransactionWriter.addBuyTransaction(game, buyerUsername);
+        coPurchaseIndex.recordPurchases({game.getGameName()}, ownedGameNames);
+    }
+
+    // Helper function to handle the "cart" transaction
+    void handleCartTransaction()
+    {
+        std::vector<std::pair<std::string, std::string>> items;
+        if (!gameManager.promptCart(items))
+            return;
+
+        std::vector<Game> cart;
+        std::string buyerUsername;
+        std::vector<std::string> ownedGameNames;
+        if (!applyChanges([this, &cart, &items, &buyerUsername, &ownedGameNames]()
+                          {
+                              cart = gameManager.buyCart(items);
+                              buyerUsername = sharedData.getCurrentUser().getUsername();
+                              ownedGameNames = sharedData.getCurrentUser().getGameNames();
+                              return !cart.empty();
+                          }))
+            return;
 
-            std::string buyerUsername = sharedData.getCurrentUser().getUsername();
-            dailyTransactionWriter.addBuyTransaction(game, buyerUsername);
+        std::cout << cart.size() << " games purchased successfully." << std::endl;
+        std::vector<std::string> boughtGameNames;
+        for (Game &game : cart)
+        {
+            std::string itemBuyerUsername = buyerUsername;
+            dailyTransactionWriter.addBuyTransaction(game, itemBuyerUsername);
+            boughtGameNames.push_back(game.getGameName());
         }
+        coPurchaseIndex.recordPurchases(boughtGameNames, ownedGameNames);
     }
 
     // Helper function to handle the "create" transaction
     void handleCreateTransaction()
     {
-        if (sharedData.getCurrentUser().getType() != Admin && sharedData.getCurrentUser().getType() != AccountManager)
-        {
-            std::cout << "User unauthorized" << std::endl;
-        }
-        else
-        {
-            User user = userManager.createUser();
-            dailyTransactionWriter.addUserTransaction("01", user);
-        }
+        User newUser = userManager.promptNewUser();
+
+        User user("", 0, 0.0);
+        if (!applyChanges([this, &user, &newUser]()
+                          {
+                              user = userManager.createUser(newUser);
+                              return user.getUsername() != "";
+                          }))
+            return;
+
+        std::cout << "User created successfully." << std::endl;
+        dailyTransactionWriter.addUserTransaction("01", user);
     }
 
     // Helper function to handle the "delete" transaction
     void handleDeleteTransaction()
     {
-        if (sharedData.getCurrentUser().getType() != Admin && sharedData.getCurrentUser().getType() != AccountManager)
+        std::string usernameToDelete = userManager.promptDeleteUser();
+
+        User deletedUser("", 0, 0.0);
+        if (!applyChanges([this, &deletedUser, &usernameToDelete]()
+                          {
+                              deletedUser = userManager.deleteUser(usernameToDelete);
+
+                              // If user deletion failed
+                              if (deletedUser.getUsername() == "")
+                                  return false;
+
+                              std::string deleteUsername = deletedUser.getUsername();
+                              gameManager.removeUserGames(deleteUsername);
+                              return true;
+                          }))
+            return;
+
+        std::cout << "User deleted successfully." << std::endl;
+        std::cout << "User's games deleted successfully." << std::endl;
+        dailyTransactionWriter.addUserTransaction("02", deletedUser);
+    }
+
+    // Helper function to handle the "refund" transaction
+    void handleRefundTransaction()
+    {
+        refundResult request = userManager.promptRefund();
+        if (request.buyerUsername == "")
+            return;
+
+        refundResult refund = {"", "", 0.0};
+        if (!applyChanges([this, &refund, &request]()
+                          {
+                              refund = userManager.refund(request, purchaseHistory, velocityGuard);
+                              return refund.buyerUsername != "";
+                          }))
+            return;
+
+        std::cout << "Refund successful. Transferred " << refund.creditAmount << " credits from " << refund.sellerUsername
+                  << " to " << refund.buyerUsername << "." << std::endl;
+        dailyTransactionWriter.addRefundTransaction(refund.buyerUsername, refund.sellerUsername, refund.creditAmount);
+    }
+
+    // Helper function to handle the "addcredit" transaction
+    void handleAddCreditTransaction()
+    {
+        std::string username;
+        double creditAmount;
+        if (!userManager.promptAddCredit(username, creditAmount))
+            return;
+
+        User user("", 0, 0.0);
+        if (!applyChanges([this, &user, &username, creditAmount]()
+                          {
+                              User *creditedUser = userManager.addCredit(username, creditAmount, velocityGuard);
+                              if (creditedUser == nullptr)
+                                  return false;
+                              user = *creditedUser;
+                              return true;
+                          }))
+            return;
+
+        std::cout << "Credit added successfully. New credit for user " << username << ": " << user.getCredit() << std::endl;
+        dailyTransactionWriter.addUserTransaction("06", user);
+    }
+
+    // Helper function to handle the "bulkcreate" transaction
+    void handleBulkCreateTransaction()
+    {
+        std::vector<CsvRow> rows;
+        if (!userManager.readBulkFile(rows))
+            return;
+
+        std::vector<User> newUsers;
+        if (!applyChanges([this, &newUsers, &rows]()
+                          {
+                              newUsers = userManager.bulkCreateUsers(rows);
+                              return rows.empty() || !newUsers.empty();
+                          }))
+            return;
+
+        std::cout << newUsers.size() << " users created successfully." << std::endl;
+        for (User &user : newUsers)
+            dailyTransactionWriter.addUserTransaction("01", user);
+    }
+
+    // Helper function to handle the "bulkdelete" transaction
+    void handleBulkDeleteTransaction()
+    {
+        std::vector<CsvRow> rows;
+        if (!userManager.readBulkFile(rows))
+            return;
+
+        std::vector<User> deletedUsers;
+        if (!applyChanges([this, &deletedUsers, &rows]()
+                          {
+                              deletedUsers = userManager.bulkDeleteUsers(rows);
+                              if (deletedUsers.empty())
+                                  return rows.empty();
+
+                              std::vector<std::string> deletedUsernames;
+                              for (const User &user : deletedUsers)
+                                  deletedUsernames.push_back(user.getUsername());
+                              gameManager.removeUsersGames(deletedUsernames);
+                              return true;
+                          }))
+            return;
+
+        std::cout << deletedUsers.size() << " users deleted successfully." << std::endl;
+        if (!deletedUsers.empty())
+            std::cout << "Deleted users' games removed successfully." << std::endl;
+        for (User &user : deletedUsers)
+            dailyTransactionWriter.addUserTransaction("02", user);
+    }
+
+    // Helper function to handle the "bulkaddcredit" transaction
+    void handleBulkAddCreditTransaction()
+    {
+        std::vector<CsvRow> rows;
+        if (!userManager.readBulkFile(rows))
+            return;
+
+        std::vector<User> updatedUsers;
+        if (!applyChanges([this, &updatedUsers, &rows]()
+                          {
+                              updatedUsers = userManager.bulkAddCredit(rows, velocityGuard);
+                              return rows.empty() || !updatedUsers.empty();
+                          }))
+            return;
+
+        std::cout << "Credit added successfully to " << updatedUsers.size() << " users." << std::endl;
+        for (User &user : updatedUsers)
+            dailyTransactionWriter.addUserTransaction("06", user);
+    }
+
+    // Helper function to handle the "list" transaction
+    void handleListTransaction()
+    {
+        // Sorting, filtering and paging arguments follow "list" on the same line
+        std::string arguments;
+        std::getline(std::cin, arguments);
+        if (arguments.find_first_not_of(" \t\r") == std::string::npos)
         {
-            std::cout << "User unauthorized" << std::endl;
+            std::lock_guard<std::mutex> lock(sharedData.getMutex());
+            gameManager.listAvailableGames();
+            return;
         }
-        else
+
+        StoreQuery query;
+        std::string error = parseStoreQuery(arguments, query);
+        if (!error.empty())
         {
-            User deletedUser = userManager.deleteUser();
+            std::cout << "Error: " << error << std::endl;
+            std::cout << "Usage: list [sort=name|price|seller] [min=<price>] [max=<price>] [seller=<username>] "
+                         "[limit=<n>] [page=<n>] [after=<cursor>]"
+                      << std::endl;
+            return;
+        }
 
-            // If user deletion failed
-            if (deletedUser.getUsername() == "")
-                return;
+        std::lock_guard<std::mutex> lock(sharedData.getMutex());
+        gameManager.listStorePage(query);
+    }
 
-            std::string deleteUsername = deletedUser.getUsername();
-            gameManager.removeUserGames(deleteUsername);
-            dailyTransactionWriter.addUserTransaction("02", deletedUser);
+    // Helper function to handle the "search" transaction
+    void handleSearchTransaction()
+    {
+        // The search text follows "search" on the same line, or is asked for
+        std::string text;
+        std::getline(std::cin, text);
+        if (text.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            std::cout << "Enter the game name to search for: ";
+            std::getline(std::cin, text);
         }
+        size_t first = text.find_first_not_of(" \t");
+        size_t last = text.find_last_not_of(" \t\r");
+
+        std::lock_guard<std::mutex> lock(sharedData.getMutex());
+        gameManager.searchGames(first == std::string::npos ? "" : text.substr(first, last - first + 1));
     }
 
-    // Helper function to handle the "refund" transaction
-    void handleRefundTransaction()
+    // Helper function to handle the "recommend" transaction
+    void handleRecommendTransaction()
     {
-        if (sharedData.getCurrentUser().getType() != Admin && sharedData.getCurrentUser().getType() != AccountManager)
+        // The game name follows "recommend" on the same line, or is asked for
+        std::string text;
+        std::getline(std::cin, text);
+        if (text.find_first_not_of(" \t\r") == std::string::npos)
         {
-            std::cout << "User unauthorized" << std::endl;
+            std::cout << "Enter the game name to get recommendations for: ";
+            std::getline(std::cin, text);
         }
-        else
-        {
-            refundResult refund = userManager.refund();
+        size_t first = text.find_first_not_of(" \t");
+        size_t last = text.find_last_not_of(" \t\r");
+        std::string gameName = first == std::string::npos ? "" : text.substr(first, last - first + 1);
 
-            // If refund failed
-            if (refund.buyerUsername == "")
-                return;
+        std::vector<CoPurchase> alsoOwned = coPurchaseIndex.getAlsoOwned(gameName, maxRecommendations);
+        if (alsoOwned.empty())
+        {
+            std::cout << "No recommendations for \"" << gameName << "\"." << std::endl;
+            return;
+        }
 
-            dailyTransactionWriter.addRefundTransaction(refund.buyerUsername, refund.sellerUsername, refund.creditAmount);
+        std::ostringstream recommendations;
+        recommendations << "Users who own " << gameName << " also own:" << '\n';
+        recommendations << std::setw(30) << std::left << "Game Name"
+                        << std::setw(10) << std::left << "Owners" << '\n';
+        for (const CoPurchase &game : alsoOwned)
+        {
+            recommendations << std::setw(30) << std::left << game.gameName
+                            << std::setw(10) << std::left << game.coOwners << '\n';
+            recommendations << std::string(40, '-') << '\n';
         }
+        std::cout << recommendations.str() << std::flush;
     }
 
-    // Helper function to handle the "addcredit" transaction
-    void handleAddCreditTransaction()
+    // Helper function to handle the "history" transaction
+    void handleHistoryTransaction()
     {
-        if (sharedData.getCurrentUser().getType() != Admin && sharedData.getCurrentUser().getType() != AccountManager)
+        // "history <date> credit <username>" or "history <date> listed <game name>" on the same line
+        std::string arguments;
+        std::getline(std::cin, arguments);
+        std::istringstream argumentStream(arguments);
+        std::string date;
+        std::string kind;
+        std::string name;
+        argumentStream >> date >> kind;
+        std::getline(argumentStream >> std::ws, name);
+        size_t last = name.find_last_not_of(" \t\r");
+        name.erase(last == std::string::npos ? 0 : last + 1);
+        if (!isHistoryDate(date) || (kind != "credit" && kind != "listed") || name.empty())
         {
-            std::cout << "User unauthorized" << std::endl;
+            std::cout << "Usage: history <YYYY-MM-DD> credit <username> | history <YYYY-MM-DD> listed <game name>" << std::endl;
+            return;
+        }
+
+        const DayState *state = stateHistory.getDayState(date);
+        if (state == nullptr)
+        {
+            std::cout << "No history recorded on or before " << date << "." << std::endl;
+            return;
+        }
+
+        std::ostringstream answer;
+        answer << std::fixed << std::setprecision(2);
+        if (kind == "credit")
+        {
+            const HistoricalAccount *account = state->accounts.find(name);
+            if (account == nullptr)
+                answer << name << " had no account at the end of " << date << "." << '\n';
+            else
+                answer << "Credit of " << name << " at the end of " << date << ": " << centsToAmount(account->creditCents) << '\n';
         }
         else
         {
-            User *user = userManager.addCredit();
-            if (user != nullptr)
+            const HistoricalListings *listings = state->listings.find(name);
+            if (listings == nullptr)
+            {
+                answer << name << " was not listed at the end of " << date << "." << '\n';
+            }
+            else
             {
-                dailyTransactionWriter.addUserTransaction("06", *user);
+                answer << name << " was listed at the end of " << date << " by:" << '\n';
+                answer << std::setw(20) << std::left << "Seller"
+                       << std::setw(10) << std::left << "Price" << '\n';
+                for (const auto &listing : *listings)
+                    answer << std::setw(20) << std::left << listing.first << std::setw(10) << centsToAmount(listing.second) << '\n';
             }
         }
+        std::cout << answer.str() << std::flush;
     }
 
-    // Helper function to handle the "list" transaction
-    void handleListTransaction()
+    // Helper function to handle the "topsellers" transaction
+    void handleTopSellersTransaction()
     {
-        gameManager.listAvailableGames();
+        // The number of sellers to show follows "topsellers" on the same line
+        std::string arguments;
+        std::getline(std::cin, arguments);
+        std::istringstream argumentStream(arguments);
+        std::string countText;
+        size_t count = 10;
+        if (argumentStream >> countText && !parseCount(countText, 1, 1000, count))
+        {
+            std::cout << "Error: Invalid number of sellers " << countText << std::endl;
+            std::cout << "Usage: topsellers [<n from 1 to 1000>]" << std::endl;
+            return;
+        }
+
+        std::vector<std::pair<std::string, SellerStats>> topSellers = sellerRevenue.getTopSellers(count);
+        if (topSellers.empty())
+        {
+            std::cout << "No sales recorded." << std::endl;
+            return;
+        }
+
+        std::ostringstream leaderboard;
+        leaderboard << "Top Sellers:" << '\n';
+        leaderboard << std::setw(6) << std::left << "Rank"
+                    << std::setw(20) << std::left << "Seller"
+                    << std::setw(8) << std::left << "Units"
+                    << std::setw(12) << std::left << "Gross"
+                    << std::setw(12) << std::left << "Refunds"
+                    << std::setw(12) << std::left << "Net" << '\n';
+        leaderboard << std::fixed << std::setprecision(2);
+        for (size_t rank = 0; rank < topSellers.size(); rank++)
+        {
+            const SellerStats &stats = topSellers[rank].second;
+            leaderboard << std::setw(6) << std::left << rank + 1
+                        << std::setw(20) << std::left << topSellers[rank].first
+                        << std::setw(8) << std::left << stats.unitsSold
+                        << std::setw(12) << std::left << centsToAmount(stats.grossCents)
+                        << std::setw(12) << std::left << centsToAmount(stats.refundedCents)
+                        << std::setw(12) << std::left << centsToAmount(stats.getNetCents()) << '\n';
+            leaderboard << std::string(70, '-') << '\n';
+        }
+        std::cout << leaderboard.str() << std::flush;
+    }
+
+    // Helper function to handle the "analytics" transaction
+    void handleAnalyticsTransaction()
+    {
+        // Report options follow "analytics" on the same line
+        std::string arguments;
+        std::getline(std::cin, arguments);
+
+        AnalyticsQuery query;
+        std::string error = parseAnalyticsQuery(arguments, query);
+        if (!error.empty())
+        {
+            std::cout << "Error: " << error << std::endl;
+            std::cout << "Usage: analytics [days=<n>] [with=<sketch file>]... [game=<name>]" << std::endl;
+            return;
+        }
+        transactionSketches.printReport(query);
     }
 
     // Helper function to handle the "listusers" transaction
     void handleListUsersTransaction()
     {
-        if (sharedData.getCurrentUser().getType() != Admin && sharedData.getCurrentUser().getType() != AccountManager)
+        // Ordering, filter and paging options follow "listusers" on the same line
+        std::string arguments;
+        std::getline(std::cin, arguments);
+        if (arguments.find_first_not_of(" \t\r") == std::string::npos)
         {
-            std::cout << "User unauthorized" << std::endl;
+            std::lock_guard<std::mutex> lock(sharedData.getMutex());
+            userManager.listUsers();
+            return;
         }
-        else
+
+        AccountQuery query;
+        std::string error = parseAccountQuery(arguments, query);
+        if (!error.empty())
         {
-            userManager.listUsers();
+            std::cout << "Error: " << error << std::endl;
+            std::cout << "Usage: listusers [sort=name|type|credit] [type=AA|FS|BS|SS|AM] [min=<credit>] [max=<credit>] "
+                         "[limit=<n>] [page=<n>] [after=<cursor>]"
+                      << std::endl;
+            return;
         }
+
+        std::lock_guard<std::mutex> lock(sharedData.getMutex());
+        userManager.listUsersPage(query);
     }
 };
 
+// Roles, durability and handler of every transaction code
+inline constexpr TransactionHandler::TransactionDescriptor TransactionHandler::transactions[] = {
+    {"login", false, anyRole, "", SessionDurable, &TransactionHandler::handleLoginTransaction},
+    {"logout", true, anyRole, "", SessionDurable, &TransactionHandler::handleLogoutTransaction},
+    {"sell", true, anyRole & ~roleBit(BuyStandard), "You do not have the privilege to sell a game.", MasterDurable, &TransactionHandler::handleSellTransaction},
+    {"buy", true, anyRole & ~roleBit(SellStandard), "You do not have the privilege to sell a game.", MasterDurable, &TransactionHandler::handleBuyTransaction},
+    {"cart", true, anyRole & ~roleBit(SellStandard), "You do not have the privilege to buy a game.", MasterDurable, &TransactionHandler::handleCartTransaction},
+    {"create", true, privilegedRoles, "User unauthorized", MasterDurable, &TransactionHandler::handleCreateTransaction},
+    {"delete", true, privilegedRoles, "User unauthorized", MasterDurable, &TransactionHandler::handleDeleteTransaction},
+    {"refund", true, privilegedRoles, "User unauthorized", MasterDurable, &TransactionHandler::handleRefundTransaction},
+    {"addcredit", true, privilegedRoles, "User unauthorized", MasterDurable, &TransactionHandler::handleAddCreditTransaction},
+    {"list", true, anyRole, "", ReadOnly, &TransactionHandler::handleListTransaction},
+    {"search", true, anyRole, "", ReadOnly, &TransactionHandler::handleSearchTransaction},
+    {"recommend", true, anyRole, "", ReadOnly, &TransactionHandler::handleRecommendTransaction},
+    {"listusers", true, privilegedRoles, "User unauthorized", ReadOnly, &TransactionHandler::handleListUsersTransaction},
+    {"topsellers", true, privilegedRoles, "User unauthorized", ReadOnly, &TransactionHandler::handleTopSellersTransaction},
+    {"promote", true, privilegedRoles, "User unauthorized", SessionDurable, &TransactionHandler::handlePromoteTransaction},
+    {"history", true, privilegedRoles, "User unauthorized", ReadOnly, &TransactionHandler::handleHistoryTransaction},
+    {"analytics", true, privilegedRoles, "User unauthorized", ReadOnly, &TransactionHandler::handleAnalyticsTransaction},
+    {"bulkcreate", true, privilegedRoles, "User unauthorized", MasterDurable, &TransactionHandler::handleBulkCreateTransaction},
+    {"bulkdelete", true, privilegedRoles, "User unauthorized", MasterDurable, &TransactionHandler::handleBulkDeleteTransaction},
+    {"bulkaddcredit", true, privilegedRoles, "User unauthorized", MasterDurable, &TransactionHandler::handleBulkAddCreditTransaction},
+};
+
+inline constexpr PerfectHashTable<TransactionHandler::transactionSlotCount> TransactionHandler::transactionSlots =
+    buildPerfectHashTable<TransactionHandler::transactionSlotCount>(TransactionHandler::transactions);
+
+static_assert(TransactionHandler::transactionSlots.perfect, "No collision-free seed for the transaction codes; grow transactionSlotCount");
+
 #endif
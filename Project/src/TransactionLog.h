@@ -0,0 +1,127 @@
+#ifndef TRANSACTION_LOG_H
+#define TRANSACTION_LOG_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "FileHash.h"
+#include "FixedDecimal.h"
+#include "MappedFile.h"
+
+// Helpers for indexes derived from the daily transaction file and kept up to date by reading
+// only what has been appended to it since they were last written.
+
+// Position in the daily transaction file up to which a derived index is complete
+struct LogWatermark
+{
+    uint64_t offset = 0;
+
+    // Hash of the bytes just before the offset, which tells whether the file was replaced since
+    uint64_t tailHash = fnvOffsetBasis;
+};
+
+// Number of bytes before the watermark that identify the log
+constexpr uint64_t logTailLength = 64;
+
+// Function to get the hash of the bytes just before an offset of the log
+inline uint64_t hashLogTail(const MappedFile &log, uint64_t offset)
+{
+    uint64_t start = offset > logTailLength ? offset - logTailLength : 0;
+    return hashBytes(log.data() + start, offset - start);
+}
+
+// Function to check that the log is still the one the watermark was taken from
+inline bool logMatchesWatermark(const MappedFile &log, const LogWatermark &watermark)
+{
+    return log.size() >= watermark.offset && hashLogTail(log, watermark.offset) == watermark.tailHash;
+}
+
+// Function to call handleRecord(line, offset) for each complete line past the watermark and move the watermark after them
+// Returns true if the watermark moved
+template <typename Handler>
+bool readNewLogRecords(const MappedFile &log, LogWatermark &watermark, Handler handleRecord)
+{
+    const char *data = log.data();
+    uint64_t offset = watermark.offset;
+    while (offset < log.size())
+    {
+        const void *newline = std::memchr(data + offset, '\n', log.size() - offset);
+        if (newline == nullptr)
+            break; // A record still being written is picked up next time
+
+        uint64_t lineEnd = static_cast<const char *>(newline) - data;
+        handleRecord(std::string(data + offset, lineEnd - offset), offset);
+        offset = lineEnd + 1;
+    }
+
+    if (offset == watermark.offset)
+        return false;
+
+    watermark.offset = offset;
+    watermark.tailHash = hashLogTail(log, offset);
+    return true;
+}
+
+// Function to get a fixed-width field of a log record without its padding
+inline std::string logField(const std::string &record, size_t start, size_t width, char padding)
+{
+    if (record.length() < start + width)
+        return "";
+
+    size_t length = width;
+    while (length > 0 && record[start + length - 1] == padding)
+        length--;
+    return record.substr(start, length);
+}
+
+// A buy transaction (04 record): game(19) seller(15) buyer(14) price
+// The record truncates the names to those widths
+struct LoggedBuy
+{
+    std::string gameName;
+    std::string sellerUsername;
+    std::string buyerUsername;
+    int64_t priceCents;
+};
+
+// A refund transaction (05 record): seller(15, '_' padded) buyer(15, '_' padded) credit
+struct LoggedRefund
+{
+    std::string sellerUsername;
+    std::string buyerUsername;
+    int64_t creditCents;
+};
+
+// Function to strip the newline from a log record
+inline std::string trimLogRecord(const std::string &record)
+{
+    size_t end = record.find_last_not_of("\r\n");
+    return end == std::string::npos ? "" : record.substr(0, end + 1);
+}
+
+// Function to parse a 04 record; returns false if the record is anything else or malformed
+inline bool parseLoggedBuy(const std::string &record, LoggedBuy &buy)
+{
+    std::string line = trimLogRecord(record);
+    if (line.compare(0, 3, "04 ") != 0 || line.length() <= 54 || !parseDecimalCents(line.substr(54), buy.priceCents))
+        return false;
+
+    buy.gameName = logField(line, 3, 19, ' ');
+    buy.sellerUsername = logField(line, 23, 15, ' ');
+    buy.buyerUsername = logField(line, 39, 14, ' ');
+    return true;
+}
+
+// Function to parse a 05 record; returns false if the record is anything else or malformed
+inline bool parseLoggedRefund(const std::string &record, LoggedRefund &refund)
+{
+    std::string line = trimLogRecord(record);
+    if (line.compare(0, 3, "05 ") != 0 || line.length() <= 35 || !parseDecimalCents(line.substr(35), refund.creditCents))
+        return false;
+
+    refund.sellerUsername = logField(line, 3, 15, '_');
+    refund.buyerUsername = logField(line, 19, 15, '_');
+    return true;
+}
+
+#endif
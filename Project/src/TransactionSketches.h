@@ -0,0 +1,480 @@
+#ifndef TRANSACTION_SKETCHES_H
+#define TRANSACTION_SKETCHES_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+#include "DailyTransactionWriter.h"
+#include "MappedFile.h"
+#include "PageCursor.h"
+#include "Sketches.h"
+#include "TransactionLog.h"
+
+// Identification of the sketch file format; bump the version whenever a layout below changes
+const char sketchMagic[8] = {'S', 'T', 'M', '2', 'S', 'K', 'C', 'H'};
+const uint32_t sketchVersion = 1;
+const uint32_t sketchByteOrderMark = 0x01020304;
+
+// Longest name (plus terminator) a sketch record can hold
+const size_t sketchNameLength = 32;
+
+// Number of sellers the heavy-hitter list keeps
+const size_t sketchHitterCount = 20;
+
+// Fixed-size records of the sketch file, laid out one after another:
+// header, buyers sketch, seller units sketch, heavy hitters, days, games
+struct SketchHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint64_t watermarkOffset;
+    uint64_t watermarkHash;
+    uint64_t hitterCount;
+    uint64_t dayCount;
+    uint64_t gameCount;
+};
+
+struct SketchHitter
+{
+    char sellerName[sketchNameLength];
+    uint32_t estimate;
+    uint32_t reserved;
+};
+
+// Distinct games traded and users active on one day ("YYYY-MM-DD")
+struct SketchDay
+{
+    char date[16];
+    HyperLogLog games;
+    HyperLogLog users;
+};
+
+// Distinct buyers of one game
+struct SketchGame
+{
+    char gameName[sketchNameLength];
+    HyperLogLog buyers;
+};
+
+// Options of the analytics report, parsed from the arguments after "analytics"
+struct AnalyticsQuery
+{
+    size_t days = 7;
+    std::string gameName;
+    std::vector<std::string> otherSketchFilenames;
+};
+
+// Function to parse "days=<n> with=<sketch file> ... game=<name>"; game= takes the rest of the line
+// Returns an error message, or "" if every argument is valid
+inline std::string parseAnalyticsQuery(const std::string &arguments, AnalyticsQuery &query)
+{
+    std::istringstream argumentStream(arguments);
+    std::string argument;
+    while (argumentStream >> argument)
+    {
+        size_t equals = argument.find('=');
+        std::string name = argument.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+        if (name == "game")
+        {
+            std::string rest;
+            std::getline(argumentStream, rest);
+            query.gameName = value + rest;
+            query.gameName.erase(query.gameName.find_last_not_of(" \t\r") + 1);
+            if (query.gameName.empty())
+                return "Missing value for game";
+            break;
+        }
+        if (value.empty())
+            return "Missing value for " + name;
+
+        if (name == "days")
+        {
+            if (!parseCount(value, 1, 366, query.days))
+                return "Invalid number of days " + value;
+        }
+        else if (name == "with")
+        {
+            query.otherSketchFilenames.push_back(value);
+        }
+        else
+        {
+            return "Unknown analytics option " + name;
+        }
+    }
+    return "";
+}
+
+// Mapping of a sketch file, checked to hold exactly the records its header counts
+class SketchFileView
+{
+public:
+    SketchFileView(const std::string &filename) : file(filename)
+    {
+        if (!file.isOpen() || file.size() < sizeof(SketchHeader))
+            return;
+
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, sketchMagic, sizeof(header.magic)) != 0 ||
+            header.version != sketchVersion || header.byteOrderMark != sketchByteOrderMark ||
+            header.hitterCount > file.size() || header.dayCount > file.size() || header.gameCount > file.size())
+            return;
+
+        uint64_t expectedSize = sizeof(SketchHeader) + sizeof(HyperLogLog) + sizeof(CountMinSketch) +
+                                header.hitterCount * sizeof(SketchHitter) +
+                                header.dayCount * sizeof(SketchDay) +
+                                header.gameCount * sizeof(SketchGame);
+        valid = expectedSize == file.size();
+    }
+
+    bool isValid() const
+    {
+        return valid;
+    }
+
+    const SketchHeader &getHeader() const
+    {
+        return header;
+    }
+
+    const HyperLogLog &getBuyers() const
+    {
+        return *reinterpret_cast<const HyperLogLog *>(file.data() + sizeof(SketchHeader));
+    }
+
+    const CountMinSketch &getSellerUnits() const
+    {
+        return *reinterpret_cast<const CountMinSketch *>(file.data() + sizeof(SketchHeader) + sizeof(HyperLogLog));
+    }
+
+    const SketchHitter *getHitters() const
+    {
+        return reinterpret_cast<const SketchHitter *>(file.data() + sizeof(SketchHeader) + sizeof(HyperLogLog) + sizeof(CountMinSketch));
+    }
+
+    const SketchDay *getDays() const
+    {
+        return reinterpret_cast<const SketchDay *>(getHitters() + header.hitterCount);
+    }
+
+    const SketchGame *getGames() const
+    {
+        return reinterpret_cast<const SketchGame *>(getDays() + header.dayCount);
+    }
+
+private:
+    MappedFile file;
+    SketchHeader header = {};
+    bool valid = false;
+};
+
+// Fixed-size probabilistic sketches of the daily transaction file, for distinct counts and top sellers
+class TransactionSketches : public TransactionObserver
+{
+public:
+    // Constructor that loads the sketches kept for the given daily transaction file and brings them up to date
+    TransactionSketches(const std::string &dailyTransactionFilename)
+        : logFilename(dailyTransactionFilename),
+          sketchFilename(dailyTransactionFilename + ".sketches")
+    {
+        load();
+        catchUp();
+    }
+
+    void transactionAdded(const std::string &) override {}
+
+    // Function to read the session's records from the log once logout has written them
+    void transactionsWritten() override
+    {
+        catchUp();
+    }
+
+    // Function to print the report the query asks for, merging in the sketches of the other files it names
+    void printReport(const AnalyticsQuery &query) const
+    {
+        std::vector<std::string> dates = getRecentDates(query.days);
+        std::string gameName = query.gameName.substr(0, 19);
+
+        // Only the sketches the report needs are merged, so its memory does not depend on the files
+        HyperLogLog reportBuyers = buyers;
+        CountMinSketch reportSellerUnits = sellerUnits;
+        HeavyHitters<sketchHitterCount> reportHitters = hitters;
+        std::vector<SketchDay> reportDays(dates.size(), SketchDay());
+        HyperLogLog reportGameBuyers = {};
+        for (size_t i = 0; i < dates.size(); i++)
+        {
+            auto day = days.find(dates[i]);
+            if (day != days.end())
+            {
+                reportDays[i].games = day->second.games;
+                reportDays[i].users = day->second.users;
+            }
+        }
+        auto game = gameBuyers.find(gameName);
+        if (game != gameBuyers.end())
+            reportGameBuyers = game->second;
+
+        for (const std::string &otherFilename : query.otherSketchFilenames)
+        {
+            SketchFileView other(otherFilename);
+            if (!other.isValid())
+            {
+                std::cout << "Error: " << otherFilename << " is not a sketch file." << std::endl;
+                return;
+            }
+
+            reportBuyers.merge(other.getBuyers());
+            reportSellerUnits.merge(other.getSellerUnits());
+            for (uint64_t i = 0; i < other.getHeader().dayCount; i++)
+            {
+                const SketchDay &day = other.getDays()[i];
+                for (size_t j = 0; j < dates.size(); j++)
+                {
+                    if (readName(day.date, sizeof(day.date)) == dates[j])
+                    {
+                        reportDays[j].games.merge(day.games);
+                        reportDays[j].users.merge(day.users);
+                    }
+                }
+            }
+            for (uint64_t i = 0; i < other.getHeader().gameCount; i++)
+            {
+                if (readName(other.getGames()[i].gameName, sketchNameLength) == gameName)
+                    reportGameBuyers.merge(other.getGames()[i].buyers);
+            }
+
+            // Sellers heavy in either file are ranked again on the merged counts
+            reportHitters.refresh(reportSellerUnits);
+            for (uint64_t i = 0; i < other.getHeader().hitterCount; i++)
+            {
+                std::string sellerName = readName(other.getHitters()[i].sellerName, sketchNameLength);
+                reportHitters.offer(sellerName, reportSellerUnits.estimate(sellerName));
+            }
+        }
+
+        HyperLogLog periodGames = {};
+        HyperLogLog periodUsers = {};
+        for (const SketchDay &day : reportDays)
+        {
+            periodGames.merge(day.games);
+            periodUsers.merge(day.users);
+        }
+
+        std::ostringstream report;
+        report << "Transaction Analytics (estimates):" << '\n';
+        report << "Distinct buyers: " << std::llround(reportBuyers.estimate()) << '\n';
+        report << "Distinct games traded in the last " << dates.size() << " days: " << std::llround(periodGames.estimate()) << '\n';
+        report << "Distinct active users in the last " << dates.size() << " days: " << std::llround(periodUsers.estimate()) << '\n';
+        report << std::setw(14) << std::left << "Date"
+               << std::setw(10) << std::left << "Games"
+               << std::setw(10) << std::left << "Users" << '\n';
+        for (size_t i = 0; i < dates.size(); i++)
+        {
+            report << std::setw(14) << std::left << dates[i]
+                   << std::setw(10) << std::left << std::llround(reportDays[i].games.estimate())
+                   << std::setw(10) << std::left << std::llround(reportDays[i].users.estimate()) << '\n';
+        }
+
+        report << "Top Sellers by Units Sold:" << '\n';
+        report << std::setw(20) << std::left << "Seller"
+               << std::setw(10) << std::left << "Units" << '\n';
+        for (const auto &hitter : reportHitters.getItems())
+        {
+            report << std::setw(20) << std::left << hitter.first
+                   << std::setw(10) << std::left << hitter.second << '\n';
+        }
+
+        if (!gameName.empty())
+            report << "Distinct buyers of " << gameName << ": " << std::llround(reportGameBuyers.estimate()) << '\n';
+
+        std::cout << report.str() << std::flush;
+    }
+
+private:
+    std::string logFilename;
+    std::string sketchFilename;
+
+    // The sketches, all complete up to the watermark
+    HyperLogLog buyers = {};
+    CountMinSketch sellerUnits = {};
+    HeavyHitters<sketchHitterCount> hitters;
+    std::map<std::string, SketchDay> days;
+    std::unordered_map<std::string, HyperLogLog> gameBuyers;
+    LogWatermark watermark;
+
+    // Function to get today's date and the dates before it, newest first
+    static std::vector<std::string> getRecentDates(size_t count)
+    {
+        std::vector<std::string> dates;
+        std::time_t now = std::time(nullptr);
+        for (size_t i = 0; i < count; i++)
+        {
+            std::time_t moment = now - static_cast<std::time_t>(i) * 24 * 60 * 60;
+            std::tm local;
+            char date[16];
+            localtime_r(&moment, &local);
+            std::strftime(date, sizeof(date), "%Y-%m-%d", &local);
+            dates.push_back(date);
+        }
+        return dates;
+    }
+
+    static std::string readName(const char *source, size_t length)
+    {
+        return std::string(source, strnlen(source, length));
+    }
+
+    static bool copyName(char *destination, size_t length, const std::string &name)
+    {
+        if (name.length() >= length)
+            return false;
+
+        std::memcpy(destination, name.data(), name.length());
+        return true;
+    }
+
+    // Function to feed one log record to the sketches of the given day
+    void addRecord(const std::string &record, SketchDay &day)
+    {
+        LoggedBuy buy;
+        LoggedRefund refund;
+        if (parseLoggedBuy(record, buy))
+        {
+            buyers.add(buy.buyerUsername);
+            gameBuyers[buy.gameName].add(buy.buyerUsername);
+            day.games.add(buy.gameName);
+            day.users.add(buy.buyerUsername);
+            sellerUnits.add(buy.sellerUsername, 1);
+            hitters.offer(buy.sellerUsername, sellerUnits.estimate(buy.sellerUsername));
+        }
+        else if (parseLoggedRefund(record, refund))
+        {
+            day.users.add(refund.buyerUsername);
+            day.users.add(refund.sellerUsername);
+        }
+        else if (record.compare(0, 3, "03 ") == 0)
+        {
+            // Sell: game(19) seller(13) price
+            day.games.add(logField(record, 3, 19, ' '));
+        }
+        else if (record.compare(0, 3, "06 ") == 0)
+        {
+            // Add credit: username(16) type credit
+            day.users.add(logField(record, 3, 16, ' '));
+        }
+    }
+
+    // Function to read the saved sketches, starting empty if they are missing or damaged
+    void load()
+    {
+        SketchFileView saved(sketchFilename);
+        if (!saved.isValid())
+            return;
+
+        buyers = saved.getBuyers();
+        sellerUnits = saved.getSellerUnits();
+        for (uint64_t i = 0; i < saved.getHeader().hitterCount; i++)
+            hitters.offer(readName(saved.getHitters()[i].sellerName, sketchNameLength), saved.getHitters()[i].estimate);
+        for (uint64_t i = 0; i < saved.getHeader().dayCount; i++)
+            days[readName(saved.getDays()[i].date, sizeof(SketchDay::date))] = saved.getDays()[i];
+        for (uint64_t i = 0; i < saved.getHeader().gameCount; i++)
+            gameBuyers[readName(saved.getGames()[i].gameName, sketchNameLength)] = saved.getGames()[i].buyers;
+
+        watermark.offset = saved.getHeader().watermarkOffset;
+        watermark.tailHash = saved.getHeader().watermarkHash;
+    }
+
+    // Function to write the sketches and their watermark, replacing the saved ones in one rename
+    void save()
+    {
+        SketchHeader header = {};
+        std::memcpy(header.magic, sketchMagic, sizeof(header.magic));
+        header.version = sketchVersion;
+        header.byteOrderMark = sketchByteOrderMark;
+        header.watermarkOffset = watermark.offset;
+        header.watermarkHash = watermark.tailHash;
+
+        std::vector<SketchHitter> hitterRecords;
+        for (const auto &hitter : hitters.getItems())
+        {
+            SketchHitter record = {};
+            if (copyName(record.sellerName, sketchNameLength, hitter.first))
+            {
+                record.estimate = hitter.second;
+                hitterRecords.push_back(record);
+            }
+        }
+
+        std::vector<SketchGame> gameRecords;
+        for (const auto &game : gameBuyers)
+        {
+            SketchGame record = {};
+            if (copyName(record.gameName, sketchNameLength, game.first))
+            {
+                record.buyers = game.second;
+                gameRecords.push_back(record);
+            }
+        }
+
+        header.hitterCount = hitterRecords.size();
+        header.dayCount = days.size();
+        header.gameCount = gameRecords.size();
+
+        std::string tempFilename = sketchFilename + "." + std::to_string(getpid()) + ".tmp";
+        std::ofstream sketchFile(tempFilename, std::ios::binary | std::ios::trunc);
+        sketchFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        sketchFile.write(reinterpret_cast<const char *>(&buyers), sizeof(buyers));
+        sketchFile.write(reinterpret_cast<const char *>(&sellerUnits), sizeof(sellerUnits));
+        for (const SketchHitter &record : hitterRecords)
+            sketchFile.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        for (const auto &day : days)
+            sketchFile.write(reinterpret_cast<const char *>(&day.second), sizeof(day.second));
+        for (const SketchGame &record : gameRecords)
+            sketchFile.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        sketchFile.close();
+
+        if (sketchFile.fail() || std::rename(tempFilename.c_str(), sketchFilename.c_str()) != 0)
+        {
+            std::cerr << "Error: Unable to write the sketch file." << std::endl;
+            std::remove(tempFilename.c_str());
+        }
+    }
+
+    // Function to feed the records the log has gained since the watermark, and save the sketches if there were any
+    void catchUp()
+    {
+        MappedFile log(logFilename);
+        if (!log.isOpen())
+            return;
+
+        // A replaced log (rotated to a new day) is new data; it is folded into the sketches kept so far
+        if (!logMatchesWatermark(log, watermark))
+            watermark = LogWatermark();
+
+        std::string today = getRecentDates(1)[0];
+        SketchDay &day = days[today];
+        if (day.date[0] == '\0')
+            copyName(day.date, sizeof(day.date), today);
+
+        auto feedRecord = [this, &day](const std::string &line, uint64_t)
+        {
+            addRecord(line, day);
+        };
+        if (readNewLogRecords(log, watermark, feedRecord))
+            save();
+    }
+};
+
+#endif
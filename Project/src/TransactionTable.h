@@ -0,0 +1,94 @@
+#ifndef TRANSACTION_TABLE_H
+#define TRANSACTION_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "general.h"
+
+// How far the effects of a transaction have to be persisted
+enum Durability
+{
+    ReadOnly,        // Only reads the shared data
+    SessionDurable,  // Changes the session; the daily transaction file is written on logout
+    MasterDurable    // Changes the master files through the compactor's delta journals
+};
+
+// Function to get the bit of a user type in a role bitmask (no bit for an unknown type)
+constexpr unsigned roleBit(int type)
+{
+    return type >= Admin && type <= AccountManager ? 1u << type : 0u;
+}
+
+// Role bitmasks used by the transaction descriptors
+constexpr unsigned anyRole = roleBit(Admin) | roleBit(FullStandard) | roleBit(BuyStandard) | roleBit(SellStandard) | roleBit(AccountManager);
+constexpr unsigned privilegedRoles = roleBit(Admin) | roleBit(AccountManager);
+
+// Function to hash a transaction code (FNV-1a, with a seed picked so the table has no collisions)
+constexpr uint32_t hashTransactionCode(const char *code, size_t length, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= static_cast<unsigned char>(code[i]);
+        hash *= 16777619u;
+    }
+
+    // Fold the high bits down so the seed reaches the low bits the slot is taken from
+    return hash ^ (hash >> 16);
+}
+
+constexpr size_t codeLength(const char *code)
+{
+    size_t length = 0;
+    while (code[length] != '\0')
+        length++;
+    return length;
+}
+
+// Slot table of a perfect hash: slots[hash % SlotCount] holds the index of the only code hashing there, or -1
+template <size_t SlotCount>
+struct PerfectHashTable
+{
+    uint32_t seed;
+    int8_t slots[SlotCount];
+    bool perfect;
+
+    // Function to find the index of the entry a code can only be, or -1 if no entry hashes there
+    int find(const std::string &code) const
+    {
+        return slots[hashTransactionCode(code.data(), code.length(), seed) % SlotCount];
+    }
+};
+
+// Function to search, at compile time, for a seed that gives every descriptor's code its own slot
+// Descriptors only need a "code" member; check "perfect" with a static_assert
+template <size_t SlotCount, typename Descriptor, size_t Count>
+constexpr PerfectHashTable<SlotCount> buildPerfectHashTable(const Descriptor (&descriptors)[Count])
+{
+    static_assert(Count <= SlotCount && Count < 128, "Too many entries for the perfect hash table");
+
+    PerfectHashTable<SlotCount> table = {};
+    for (uint32_t seed = 0; seed < 4096; seed++)
+    {
+        table.seed = seed;
+        table.perfect = true;
+        for (size_t slot = 0; slot < SlotCount; slot++)
+            table.slots[slot] = -1;
+
+        for (size_t i = 0; i < Count && table.perfect; i++)
+        {
+            size_t slot = hashTransactionCode(descriptors[i].code, codeLength(descriptors[i].code), seed) % SlotCount;
+            if (table.slots[slot] != -1)
+                table.perfect = false;
+            else
+                table.slots[slot] = static_cast<int8_t>(i);
+        }
+
+        if (table.perfect)
+            return table;
+    }
+    return table;
+}
+
+#endif
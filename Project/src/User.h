@@ -1,10 +1,22 @@
 #ifndef USER_H
 #define USER_H
 
+#include <memory>
 #include <string>
+#include <vector>
 #include "general.h"
 #include "Game.h"
 
+// Source that can fill in a user's games collection the first time it is needed
+class CollectionSource
+{
+public:
+    virtual ~CollectionSource() {}
+
+    // Function to return the names of the games owned by the given user
+    virtual std::vector<std::string> loadCollection(const std::string &username) const = 0;
+};
+
 class User
 {
 public:
@@ -30,9 +42,40 @@ public:
 
     const std::vector<Game> &getGamesCollection() const
     {
+        loadCollectionIfDeferred();
         return gamesCollection;
     }
 
+    // Function to list the names of the owned games without materializing a deferred collection
+    std::vector<std::string> getGameNames() const
+    {
+        if (collectionSource != nullptr)
+            return collectionSource->loadCollection(username);
+
+        std::vector<std::string> gameNames;
+        for (const Game &ownedGame : gamesCollection)
+            gameNames.push_back(ownedGame.getGameName());
+        return gameNames;
+    }
+
+    // Function to defer loading the user's collection until it is first used
+    void setCollectionSource(const std::shared_ptr<const CollectionSource> &source)
+    {
+        collectionSource = source;
+    }
+
+    // Function to check whether the collection is in memory or still deferred
+    bool isCollectionLoaded() const
+    {
+        return collectionSource == nullptr;
+    }
+
+    // Setter method to update the user's type
+    void setType(int type)
+    {
+        this->type = type;
+    }
+
     // Setter method to update the user's credit
     void setCredit(double credit)
     {
@@ -42,11 +85,20 @@ public:
     // Function to add a game to the user's collection by name
     void addGameToCollection(const std::string &gameName)
     {
+        loadCollectionIfDeferred();
         gamesCollection.push_back(Game(gameName, username, 0.0));
     }
 
+    // Function to remove every game from the user's collection
+    void clearGamesCollection()
+    {
+        collectionSource.reset();
+        gamesCollection.clear();
+    }
+
     bool hasGameInCollection(const std::string &gameName)
     {
+        loadCollectionIfDeferred();
         for (Game &ownedGame : gamesCollection)
         {
             if (ownedGame.getGameName() == gameName)
@@ -63,7 +115,22 @@ private:
     int type;
     double credit;
     // Member variable representing the vector of games in the user's collection
-    std::vector<Game> gamesCollection;
+    // Both are mutable because a deferred collection is materialized on first read
+    mutable std::vector<Game> gamesCollection;
+    // Member variable holding where to load a deferred collection from (null once loaded)
+    mutable std::shared_ptr<const CollectionSource> collectionSource;
+
+    // Function to materialize a deferred collection
+    void loadCollectionIfDeferred() const
+    {
+        if (collectionSource == nullptr)
+            return;
+
+        std::shared_ptr<const CollectionSource> source = collectionSource;
+        collectionSource.reset();
+        for (const std::string &gameName : source->loadCollection(username))
+            gamesCollection.push_back(Game(gameName, username, 0.0));
+    }
 };
 
 #endif
@@ -1,11 +1,18 @@
 #ifndef USER_MANAGER_H
 #define USER_MANAGER_H
 
+#include <unordered_map>
+#include <unordered_set>
 #include "general.h"
-#include "UserUpdater.h"
 #include "FileReader.h"
+#include "CsvReader.h"
+#include "FixedDecimal.h"
+#include "Compactor.h"
 #include "CreditUpdater.h"
 #include "SharedData.h"
+#include "Options.h"
+#include "PurchaseHistory.h"
+#include "VelocityGuard.h"
 
 struct refundResult
 {
@@ -17,19 +24,26 @@ struct refundResult
 class UserManager
 {
 public:
-    // Constructor that takes a SharedData reference and a filename for user data
-    UserManager(SharedData &sharedData, const std::string &userFilename)
-        : userUpdater(userFilename),
-          creditUpdater(sharedData, userFilename),
+    // Constructor that takes a SharedData reference, a filename for user data, the compactor persisting it and the options
+    UserManager(SharedData &sharedData, const std::string &userFilename, Compactor &compactor, const Options &options = Options())
+        : compactor(compactor),
+          creditUpdater(sharedData, compactor),
           fileReader(userFilename),
           sharedData(sharedData),
           users(sharedData.getUsers()),
-          currentUser(sharedData.getCurrentUser())
+          currentUser(sharedData.getCurrentUser()),
+          accountsFilename(userFilename),
+          maxInMemorySortRecords(options.maxInMemorySortRecords)
     {
+        // The accounts were already restored from an up-to-date snapshot
+        if (sharedData.isLoadedFromSnapshot())
+            return;
+
         // Attempt to open the file for reading and read user data
         if (fileReader.openFile())
         {
-            fileReader.readUsers(users);
+            if (!fileReader.readUsers(users))
+                sharedData.setLoadFailed();
             fileReader.closeFile();
         }
         else
@@ -38,43 +52,54 @@ public:
         }
     }
 
-    // Function to create a new user
-    User createUser()
+    // Function to ask for the username and type of a new user
+    User promptNewUser()
     {
         std::string username = getUsername();
-        int userType = getType();
+        int userType = getUserTypeFromMenuNumber(getType());
 
         // Create a new user object with the provided information
-        User newUser(username, userType, 0.0);
+        return User(username, userType, 0.0);
+    }
 
+    // Function to create a new user; the caller holds the SharedData mutex
+    User createUser(const User &newUser)
+    {
         // if the user account is AccountManager and they are trying to create an Admin account
         // do not let them
-        if (currentUser.getType() == 4 && newUser.getType() == 1)
+        if (currentUser.getType() == AccountManager && newUser.getType() == Admin)
         {
             std::cout << "AccountManager cannot create an Admin account." << std::endl;
             return User("", 0, 0.0);
         }
 
-        // Add the new user to the vector of users
-        users.push_back(newUser);
-
-        // Open the file and write the new user information
-        if (userUpdater.openFile())
+        // The username may have been taken while the type was asked for
+        if (isUsernameTaken(newUser.getUsername()))
         {
-            userUpdater.addUser(newUser);
-            userUpdater.closeFile();
-            std::cout << "User created successfully." << std::endl;
-        }
-        else
-        {
-            std::cerr << "Error: Unable to open the file for writing." << std::endl;
+            std::cout << "This username is already taken" << std::endl;
+            return User("", 0, 0.0);
         }
 
+        // Add the new user to the vector of users and record it for the accounts file
+        users.push_back(newUser);
+        compactor.recordUserUpdate(newUser);
+        sharedData.getChangeFeed().accountChanged(nullptr, &newUser);
+
         return newUser;
     }
 
-    // Function to delete a user
-    User deleteUser()
+    // Function to ask for the username of the user to delete
+    std::string promptDeleteUser()
+    {
+        // Get the username to be deleted
+        std::string usernameToDelete;
+        std::cout << "Enter the username to delete: ";
+        std::cin >> usernameToDelete;
+        return usernameToDelete;
+    }
+
+    // Function to delete a user; the caller holds the SharedData mutex
+    User deleteUser(const std::string &usernameToDelete)
     {
         // Check if the current user is an admin or account manager
         if (currentUser.getType() != Admin && currentUser.getType() != AccountManager)
@@ -84,11 +109,6 @@ public:
             return User("", 0, 0.0);
         }
 
-        // Get the username to be deleted
-        std::string usernameToDelete;
-        std::cout << "Enter the username to delete: ";
-        std::cin >> usernameToDelete;
-
         // Check if the provided username exists and is not the current user's username
         auto userToDelete = std::find_if(users.begin(), users.end(), [usernameToDelete](const User &user)
                                          { return user.getUsername() == usernameToDelete; });
@@ -107,35 +127,19 @@ public:
             std::cout << "AccountManager cannot delete an Admin account." << std::endl;
             return User("", 0, 0.0);
         }
-        if (currentUser.getType() == 4 && userToDelete -> getType() == 1)
-        {
-            std::cout << "AccountManager cannot delete an Admin account." << std::endl;
-            return User("", 0, 0.0);
-        }
 
-        // Remove the user account
+        // Remove the user account and record the deletion for the accounts file
         User deletedUser = *userToDelete;
 
-        if (userUpdater.openFile())
-        {
-            userUpdater.deleteUser(deletedUser);
-            userUpdater.closeFile();
-        }
-        else
-        {
-            std::cerr << "Error: Unable to open the file for writing." << std::endl;
-            return User("", 0, 0.0);
-        }
-
         users.erase(userToDelete);
-
-        std::cout << "User deleted successfully." << std::endl;
+        compactor.recordUserDeletion(deletedUser.getUsername());
+        reportDeletedUser(deletedUser);
 
         return deletedUser;
     }
 
-    // Function to process a refund
-    refundResult refund()
+    // Function to ask for the buyer, seller and amount of a refund
+    refundResult promptRefund()
     {
         std::string buyerUsername;
         std::string sellerUsername;
@@ -150,12 +154,8 @@ public:
         std::cout << "Enter the seller's username: ";
         std::getline(std::cin, sellerUsername);
 
-        // Find the buyer and seller users
-        User *buyer = sharedData.getUserByUsername(buyerUsername);
-        User *seller = sharedData.getUserByUsername(sellerUsername);
-
         // Check if the buyer and seller exist
-        if (buyer == nullptr || seller == nullptr)
+        if (!userExists(buyerUsername) || !userExists(sellerUsername))
         {
             std::cout << "Error: Buyer or seller does not exist." << std::endl;
             return {"", "", 0.0};
@@ -165,6 +165,25 @@ public:
         std::cout << "Enter the amount of credit to transfer: ";
         std::cin >> creditAmount;
 
+        return {buyerUsername, sellerUsername, creditAmount};
+    }
+
+    // Function to process a refund of purchases the buyer made from the seller; the caller holds the SharedData mutex
+    refundResult refund(const refundResult &request, const PurchaseHistory &purchaseHistory, VelocityGuard &velocityGuard)
+    {
+        const std::string &buyerUsername = request.buyerUsername;
+        const std::string &sellerUsername = request.sellerUsername;
+        double creditAmount = request.creditAmount;
+
+        // Find the buyer and seller users; either may have been deleted while the amount was asked for
+        User *buyer = sharedData.getUserByUsername(buyerUsername);
+        User *seller = sharedData.getUserByUsername(sellerUsername);
+        if (buyer == nullptr || seller == nullptr)
+        {
+            std::cout << "Error: Buyer or seller does not exist." << std::endl;
+            return {"", "", 0.0};
+        }
+
         // Check if the seller has enough credit
         if (999999.99 < creditAmount)
         {
@@ -172,6 +191,22 @@ public:
             return {"", "", 0.0};
         }
 
+        // Check that the buyer bought at least this much from the seller and it was not refunded yet
+        int64_t refundableCents = purchaseHistory.getRefundableCents(buyer->getUsername(), seller->getUsername());
+        if (refundableCents <= 0)
+        {
+            std::cout << "Error: " << buyer->getUsername() << " has no purchases from " << seller->getUsername() << " to refund." << std::endl;
+            return {"", "", 0.0};
+        }
+        if (amountToCents(creditAmount) > refundableCents)
+        {
+            std::ostringstream refundable;
+            refundable << std::fixed << std::setprecision(2) << centsToAmount(refundableCents);
+            std::cout << "Error: Only " << refundable.str() << " of the purchases from " << seller->getUsername()
+                      << " is left to refund." << std::endl;
+            return {"", "", 0.0};
+        }
+
         // Check if the seller has enough credit
         if (seller->getCredit() < creditAmount)
         {
@@ -179,6 +214,17 @@ public:
             return {"", "", 0.0};
         }
 
+        // Check the refund against the refund limits of the buyer, seller and admin
+        std::vector<VelocityEvent> events = {VelocityEvent{VelocityRefund, buyer->getUsername(), currentUser.getUsername(),
+                                                           seller->getUsername(), amountToCents(creditAmount)}};
+        std::string limitError = velocityGuard.check(events);
+        if (!limitError.empty())
+        {
+            std::cout << "Error: " << limitError << std::endl;
+            return {"", "", 0.0};
+        }
+        velocityGuard.record(events);
+
         // Transfer credit from seller to buyer
         double buyerNewCredit = buyer->getCredit() + creditAmount;
         double sellerNewCredit = seller->getCredit() - creditAmount;
@@ -187,34 +233,40 @@ public:
         creditUpdater.updateCreditForUser(buyer, buyerNewCredit);
         creditUpdater.updateCreditForUser(seller, sellerNewCredit);
 
-        std::cout << "Refund successful. Transferred " << creditAmount << " credits from " << seller->getUsername()
-                  << " to " << buyer->getUsername() << "." << std::endl;
-
         return {buyerUsername, sellerUsername, creditAmount};
     }
 
-    // Function to add credit to a user account
-    User *addCredit()
+    // Function to ask for the username and amount of a credit grant; returns false if the username does not exist
+    bool promptAddCredit(std::string &username, double &creditAmount)
     {
-        std::string username;
-        double creditAmount;
-
         // Get the username from the user
         std::cout << "Enter the username: ";
         std::cin.ignore(); // Ignore the newline character from the previous input
         std::getline(std::cin, username);
 
         // Check if the username is valid
-        User *user = sharedData.getUserByUsername(username);
-        if (user == nullptr)
+        if (!userExists(username))
         {
             std::cout << "Error: Username does not exist in the system." << std::endl;
-            return nullptr;
+            return false;
         }
 
         // Get the amount of credit to add
         std::cout << "Enter the amount of credit to add: ";
         std::cin >> creditAmount;
+        return true;
+    }
+
+    // Function to add credit to a user account; the caller holds the SharedData mutex
+    User *addCredit(const std::string &username, double creditAmount, VelocityGuard &velocityGuard)
+    {
+        // The user may have been deleted while the amount was asked for
+        User *user = sharedData.getUserByUsername(username);
+        if (user == nullptr)
+        {
+            std::cout << "Error: Username does not exist in the system." << std::endl;
+            return nullptr;
+        }
 
         // Check if the credit amount is valid
         if (creditAmount > 1000.00)
@@ -223,34 +275,308 @@ public:
             return nullptr;
         }
 
+        // Check the grant against the credit limits of the account and admin
+        std::vector<VelocityEvent> events = {VelocityEvent{VelocityCredit, user->getUsername(), currentUser.getUsername(), "", amountToCents(creditAmount)}};
+        std::string limitError = velocityGuard.check(events);
+        if (!limitError.empty())
+        {
+            std::cout << "Error: " << limitError << std::endl;
+            return nullptr;
+        }
+        velocityGuard.record(events);
+
         // Update the user's credit
         double newCredit = user->getCredit() + creditAmount;
         creditUpdater.updateCreditForUser(user, newCredit);
 
-        std::cout << "Credit added successfully. New credit for user " << username << ": " << newCredit << std::endl;
-
         return user;
     }
 
+    // Function to create every user in the rows of a CSV file of "username,type" rows, type being a code such as FS
+    // Every row is checked first; nothing is created unless all of them are valid. The caller holds the SharedData mutex
+    std::vector<User> bulkCreateUsers(const std::vector<CsvRow> &rows)
+    {
+        std::unordered_map<std::string, size_t> usersByName = indexUsersByName();
+        std::vector<User> newUsers;
+        bool valid = true;
+        for (const CsvRow &row : rows)
+        {
+            std::string error = checkBulkCreateRow(row, usersByName);
+            if (!error.empty())
+            {
+                reportBulkError(row, error);
+                valid = false;
+                continue;
+            }
+
+            // Later rows must not reuse the name either
+            usersByName[row.fields[0]] = users.size() + newUsers.size();
+            newUsers.push_back(User(row.fields[0], getUserTypeFromCode(row.fields[1]), 0.0));
+        }
+
+        if (!valid)
+        {
+            std::cout << "No users were created." << std::endl;
+            return {};
+        }
+
+        users.insert(users.end(), newUsers.begin(), newUsers.end());
+        compactor.recordUserUpdates(newUsers);
+        for (const User &newUser : newUsers)
+            sharedData.getChangeFeed().accountChanged(nullptr, &newUser);
+
+        return newUsers;
+    }
+
+    // Function to add credit to every user in the rows of a CSV file of "username,amount" rows
+    // Every row is checked first; no credit is added unless all of them are valid. The caller holds the SharedData mutex
+    std::vector<User> bulkAddCredit(const std::vector<CsvRow> &rows, VelocityGuard &velocityGuard)
+    {
+        std::unordered_map<std::string, size_t> usersByName = indexUsersByName();
+
+        // Credit added per user in this file, in cents, in the order users first appear
+        std::unordered_map<std::string, int64_t> addedCents;
+        std::vector<size_t> creditedUsers;
+        std::vector<VelocityEvent> events;
+        bool valid = true;
+        for (const CsvRow &row : rows)
+        {
+            std::string error;
+            int64_t cents = 0;
+            auto user = row.fields.size() == 2 ? usersByName.find(row.fields[0]) : usersByName.end();
+            auto added = row.fields.size() == 2 ? addedCents.find(row.fields[0]) : addedCents.end();
+            int64_t alreadyAdded = added != addedCents.end() ? added->second : 0;
+            if (row.fields.size() != 2)
+                error = "expected username,amount";
+            else if (user == usersByName.end())
+                error = "Username does not exist in the system.";
+            else if (!parseDecimalCents(row.fields[1], cents))
+                error = "invalid amount " + row.fields[1];
+            else if (alreadyAdded + cents > 100000)
+                error = "Maximum $1000.00 can be added to an account in a given session.";
+            else if (users[user->second].getCredit() + centsToAmount(alreadyAdded + cents) > 999999.99)
+                error = "the credit would exceed $999,999.99";
+
+            if (!error.empty())
+            {
+                reportBulkError(row, error);
+                valid = false;
+                continue;
+            }
+
+            if (added == addedCents.end())
+                creditedUsers.push_back(user->second);
+            addedCents[row.fields[0]] = alreadyAdded + cents;
+            events.push_back(VelocityEvent{VelocityCredit, row.fields[0], currentUser.getUsername(), "", cents});
+        }
+
+        // The whole file counts against the credit limits, one grant per row
+        std::string limitError = valid ? velocityGuard.check(events) : "";
+        if (!limitError.empty())
+        {
+            std::cout << "Error: " << limitError << std::endl;
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            std::cout << "No credit was added." << std::endl;
+            return {};
+        }
+        velocityGuard.record(events);
+
+        std::vector<User> updatedUsers;
+        updatedUsers.reserve(creditedUsers.size());
+        for (size_t index : creditedUsers)
+        {
+            User &user = users[index];
+            User before = user;
+            user.setCredit(user.getCredit() + centsToAmount(addedCents[user.getUsername()]));
+            sharedData.getChangeFeed().accountChanged(&before, &user);
+            if (user.getUsername() == currentUser.getUsername())
+                currentUser.setCredit(user.getCredit());
+            updatedUsers.push_back(user);
+        }
+        compactor.recordUserUpdates(updatedUsers);
+
+        return updatedUsers;
+    }
+
+    // Function to delete every user in the rows of a CSV file with one username per row
+    // Every row is checked first; nobody is deleted unless all of them are valid. The caller holds the SharedData mutex
+    std::vector<User> bulkDeleteUsers(const std::vector<CsvRow> &rows)
+    {
+        std::unordered_map<std::string, size_t> usersByName = indexUsersByName();
+        std::unordered_set<std::string> usernamesToDelete;
+        bool valid = true;
+        for (const CsvRow &row : rows)
+        {
+            std::string error;
+            auto user = row.fields.size() == 1 ? usersByName.find(row.fields[0]) : usersByName.end();
+            if (row.fields.size() != 1)
+                error = "expected username";
+            else if (user == usersByName.end() || row.fields[0] == currentUser.getUsername())
+                error = "Invalid username or attempting to delete the current user account.";
+            else if (currentUser.getType() == AccountManager && users[user->second].getType() == Admin)
+                error = "AccountManager cannot delete an Admin account.";
+            else if (!usernamesToDelete.insert(row.fields[0]).second)
+                error = "user is listed more than once";
+
+            if (!error.empty())
+            {
+                reportBulkError(row, error);
+                valid = false;
+            }
+        }
+
+        if (!valid)
+        {
+            std::cout << "No users were deleted." << std::endl;
+            return {};
+        }
+
+        // Remove the accounts in one pass, keeping the order of everyone else
+        std::vector<User> deletedUsers;
+        std::vector<std::string> deletedUsernames;
+        std::vector<User> remainingUsers;
+        remainingUsers.reserve(users.size() - usernamesToDelete.size());
+        for (User &user : users)
+        {
+            if (usernamesToDelete.count(user.getUsername()) != 0)
+            {
+                deletedUsernames.push_back(user.getUsername());
+                deletedUsers.push_back(std::move(user));
+            }
+            else
+            {
+                remainingUsers.push_back(std::move(user));
+            }
+        }
+        users = std::move(remainingUsers);
+        compactor.recordUserDeletions(deletedUsernames);
+        for (const User &deletedUser : deletedUsers)
+            reportDeletedUser(deletedUser);
+
+        return deletedUsers;
+    }
+
+    // Function to ask for the CSV file of a bulk transaction and read its rows
+    bool readBulkFile(std::vector<CsvRow> &rows)
+    {
+        std::string filename;
+        std::cout << "Enter the CSV filename: ";
+        std::cin >> filename;
+
+        CsvReader csvReader(filename);
+        if (!csvReader.readRows(rows))
+        {
+            std::cout << "Error: Unable to open the file " << filename << std::endl;
+            return false;
+        }
+        return true;
+    }
+
     void listUsers()
     {
         // Display header with column names
-        std::cout << "User Information:" << std::endl;
-        std::cout << std::setw(20) << std::left << "Username"
-                  << std::setw(15) << std::left << "User Type"
-                  << std::setw(10) << std::left << "Credit" << std::endl;
+        std::ostringstream listing;
+        listing << "User Information:" << '\n';
+        listing << std::setw(20) << std::left << "Username"
+                << std::setw(15) << std::left << "User Type"
+                << std::setw(10) << std::left << "Credit" << '\n';
 
         // Iterate through each user
         for (const User &user : users)
         {
             // Display user information
-            std::cout << std::setw(20) << std::left << user.getUsername()
-                      << std::setw(15) << std::left << getFullUserType(user.getType())
-                      << std::setw(10) << std::fixed << std::setprecision(2) << user.getCredit() << std::endl;
+            listing << std::setw(20) << std::left << user.getUsername()
+                    << std::setw(15) << std::left << getFullUserType(user.getType())
+                    << std::setw(10) << std::fixed << std::setprecision(2) << user.getCredit() << '\n';
 
             // Add a divider line between each user
-            std::cout << std::string(45, '-') << std::endl;
+            listing << std::string(45, '-') << '\n';
+        }
+
+        std::cout << listing.str() << std::flush;
+    }
+
+    // Function to list one page of the users in the order and with the filters of the query
+    // Only the page (and the users the filters skip) are visited once the order has been sorted
+    void listUsersPage(const AccountQuery &query)
+    {
+        // The accounts file can stand in for the table once the compactor has caught up with it
+        const SortedAccounts &sorted = sharedData.getAccountIndex().getSorted(
+            query.order, users, compactor.isClean(AccountsFile) ? accountsFilename : "", maxInMemorySortRecords);
+
+        // Start after the cursor, or at the first user the filters can match in this order
+        size_t position;
+        if (query.hasCursor)
+            position = sorted.upperBound(query.cursor);
+        else if (query.order == SortAccountsByCredit)
+            position = sorted.lowerBound(AccountEntry{"", 0, query.minCreditCents});
+        else if (query.order == SortAccountsByType && query.type != -1)
+            position = sorted.lowerBound(AccountEntry{"", query.type, 0});
+        else
+            position = 0;
+
+        auto matches = [&query](const AccountEntry &candidate)
+        {
+            return candidate.creditCents >= query.minCreditCents && candidate.creditCents <= query.maxCreditCents &&
+                   (query.type == -1 || candidate.type == query.type);
+        };
+
+        // Past this user nothing further in the order can match
+        auto pastRange = [&query](const AccountEntry &candidate)
+        {
+            return (query.order == SortAccountsByCredit && candidate.creditCents > query.maxCreditCents) ||
+                   (query.order == SortAccountsByType && query.type != -1 && candidate.type != query.type);
+        };
+
+        // Function to move to the next matching user at or after a position, filling in its entry
+        AccountEntry entry;
+        auto nextMatch = [&](size_t from)
+        {
+            for (; from < sorted.size(); from++)
+            {
+                entry = sorted.entry(from);
+                if (pastRange(entry))
+                    break;
+                if (matches(entry))
+                    return from;
+            }
+            return sorted.size();
+        };
+
+        position = nextMatch(position);
+        if (!query.hasCursor)
+        {
+            for (size_t skipped = 0; skipped < (query.page - 1) * query.pageSize && position < sorted.size(); skipped++)
+                position = nextMatch(position + 1);
         }
+
+        std::ostringstream page;
+        page << "User Information:" << '\n';
+        page << std::setw(20) << std::left << "Username"
+             << std::setw(15) << std::left << "User Type"
+             << std::setw(10) << std::left << "Credit" << '\n';
+
+        size_t shown = 0;
+        AccountEntry last;
+        for (; position < sorted.size() && shown < query.pageSize; position = nextMatch(position + 1), shown++)
+        {
+            page << std::setw(20) << std::left << entry.username
+                 << std::setw(15) << std::left << getFullUserType(entry.type)
+                 << std::setw(10) << std::fixed << std::setprecision(2) << centsToAmount(entry.creditCents) << '\n';
+            page << std::string(45, '-') << '\n';
+            last = entry;
+        }
+
+        if (shown == 0)
+            page << "No users match." << '\n';
+        else if (position < sorted.size())
+            page << "More users follow; continue with: after=" << encodeAccountCursor(last) << '\n';
+
+        std::cout << page.str() << std::flush;
     }
 
 private:
@@ -260,16 +586,36 @@ private:
     // Reference to the vector of users in shared data
     std::vector<User> &users;
 
-    // UserUpdater and FileReader objects for handling file operations
-    UserUpdater userUpdater;
+    // FileReader object for loading the accounts file
     FileReader fileReader;
 
+    // Compactor instance for persisting account changes
+    Compactor &compactor;
+
     // CreditUpdater instance for handling credit-related operations
     CreditUpdater creditUpdater;
 
     // Reference to the shared data object
     SharedData &sharedData;
 
+    // Filename of the accounts file, sorted on disk when the table is too large to sort in memory
+    std::string accountsFilename;
+
+    // Most accounts listusers sorts in memory
+    size_t maxInMemorySortRecords;
+
+    // Function to report a deleted account and the games collection that went with it to the change feed
+    void reportDeletedUser(const User &deletedUser)
+    {
+        ChangeFeed &changeFeed = sharedData.getChangeFeed();
+        if (!changeFeed.isEnabled())
+            return;
+
+        changeFeed.accountChanged(&deletedUser, nullptr);
+        for (const std::string &gameName : deletedUser.getGameNames())
+            changeFeed.ownershipChanged(gameName, deletedUser.getUsername(), false);
+    }
+
     // Function to get a valid username from the user
     std::string getUsername()
     {
@@ -279,6 +625,7 @@ private:
             std::cout << "Enter username: ";
             std::cin >> username;
 
+            std::lock_guard<std::mutex> lock(sharedData.getMutex());
             if (isUsernameValid(username))
                 break;
         }
@@ -303,7 +650,7 @@ private:
             }
 
             // If the input is a valid user type, break out of the loop
-            if (userType == 1 || userType == 2 || userType == 3 || userType == 4 || userType == 5)
+            if (getUserTypeFromMenuNumber(userType) != -1)
                 break;
         }
 
@@ -313,32 +660,94 @@ private:
     // Function to check if a username is valid
     bool isUsernameValid(std::string &username)
     {
-        // Check the length of the username
-        if (username.length() > 15)
+        std::string error = checkUsernameFormat(username);
+        if (!error.empty())
         {
-            std::cout << "Username length should be less than 15 characters" << std::endl;
+            std::cout << error << std::endl;
             return false;
         }
 
-        // Check if the username contains underscores
-        if (username.find('_') != std::string::npos)
+        // Check if the username is already taken
+        if (isUsernameTaken(username))
         {
-            std::cout << "Username should not contain underscores" << std::endl;
+            std::cout << "This username is already taken" << std::endl;
             return false;
         }
 
-        // Check if the username is already taken
+        // If all checks pass, the username is valid
+        return true;
+    }
+
+    // Function to check whether an account already has the username
+    bool isUsernameTaken(const std::string &username) const
+    {
         for (const User &user : users)
         {
             if (user.getUsername() == username)
-            {
-                std::cout << "This username is already taken" << std::endl;
-                return false;
-            }
+                return true;
         }
+        return false;
+    }
 
-        // If all checks pass, the username is valid
-        return true;
+    // Function to check, between prompts, that an account exists
+    bool userExists(const std::string &username)
+    {
+        std::lock_guard<std::mutex> lock(sharedData.getMutex());
+        return sharedData.getUserByUsername(username) != nullptr;
+    }
+
+    // Function to check the length and characters of a new username; returns the problem, or "" if there is none
+    static std::string checkUsernameFormat(const std::string &username)
+    {
+        // Check the length of the username
+        if (username.empty())
+            return "Username should not be empty";
+        if (username.length() > 15)
+            return "Username length should be less than 15 characters";
+
+        // Check if the username contains underscores or spaces, which the fixed-width files cannot hold
+        if (username.find('_') != std::string::npos)
+            return "Username should not contain underscores";
+        if (username.find(' ') != std::string::npos)
+            return "Username should not contain spaces";
+
+        return "";
+    }
+
+    // Function to check one row of a bulk create file; returns the problem, or "" if there is none
+    std::string checkBulkCreateRow(const CsvRow &row, const std::unordered_map<std::string, size_t> &usersByName) const
+    {
+        if (row.fields.size() != 2)
+            return "expected username,type";
+
+        std::string error = checkUsernameFormat(row.fields[0]);
+        if (!error.empty())
+            return error;
+        if (usersByName.count(row.fields[0]) != 0)
+            return "This username is already taken";
+
+        int userType = getUserTypeFromCode(row.fields[1]);
+        if (userType == -1)
+            return "unknown user type " + row.fields[1];
+        if (currentUser.getType() == AccountManager && userType == Admin)
+            return "AccountManager cannot create an Admin account.";
+
+        return "";
+    }
+
+    // Function to map each username to its position in the users vector
+    std::unordered_map<std::string, size_t> indexUsersByName() const
+    {
+        std::unordered_map<std::string, size_t> usersByName;
+        usersByName.reserve(users.size());
+        for (size_t i = 0; i < users.size(); i++)
+            usersByName[users[i].getUsername()] = i;
+        return usersByName;
+    }
+
+    static void reportBulkError(const CsvRow &row, const std::string &error)
+    {
+        std::cout << "Error: Line " << row.lineNumber << ": " << error << std::endl;
     }
 };
 
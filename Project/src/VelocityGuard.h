@@ -0,0 +1,416 @@
+#ifndef VELOCITY_GUARD_H
+#define VELOCITY_GUARD_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FixedDecimal.h"
+#include "PageCursor.h"
+
+// Kind of money movement a velocity rule watches
+enum VelocityOperation
+{
+    VelocityRefund, // 05 records
+    VelocityCredit, // 06 records
+    VelocityAny
+};
+
+// Whose movements a velocity rule adds up
+enum VelocitySubject
+{
+    VelocityAccount, // The account receiving the credit or refund
+    VelocityAdmin,   // The logged-in user granting it
+    VelocitySeller   // The seller paying a refund
+};
+
+// One refund or credit grant about to be applied
+struct VelocityEvent
+{
+    VelocityOperation operation;
+    std::string accountUsername;
+    std::string adminUsername;
+    std::string sellerUsername; // Empty for credit grants
+    int64_t cents;
+};
+
+// Limit on how many movements, or how much money, one subject may see within a sliding window
+struct VelocityRule
+{
+    bool reject = true; // Reject the transaction, or let it through and flag it
+    VelocitySubject subject = VelocityAccount;
+    VelocityOperation operation = VelocityAny;
+    std::chrono::seconds window{0};
+    uint64_t maxCount = UINT64_MAX;
+    int64_t maxCents = INT64_MAX;
+    std::string text; // The rule as written, for messages
+};
+
+// Function to parse a window length such as 90s, 15m, 12h or 1d
+inline bool parseVelocityWindow(const std::string &text, std::chrono::seconds &window)
+{
+    static const std::map<char, int64_t> unitSeconds = {{'s', 1}, {'m', 60}, {'h', 3600}, {'d', 86400}};
+    size_t length = 0;
+    auto unit = text.empty() ? unitSeconds.end() : unitSeconds.find(text.back());
+    if (unit == unitSeconds.end() || !parseCount(text.substr(0, text.length() - 1), 1, 999999999, length))
+        return false;
+
+    window = std::chrono::seconds(static_cast<int64_t>(length) * unit->second);
+    return true;
+}
+
+// Function to parse a rule line: <reject|flag> <account|admin|seller> <refund|credit|any> <window> [count=<n>] [amount=<dollars>]
+// Returns an empty string on success, or what is wrong with the line
+inline std::string parseVelocityRule(const std::string &line, VelocityRule &rule)
+{
+    std::istringstream fields(line);
+    std::string action;
+    std::string subject;
+    std::string operation;
+    std::string window;
+    if (!(fields >> action >> subject >> operation >> window))
+        return "expected <reject|flag> <account|admin|seller> <refund|credit|any> <window> [count=<n>] [amount=<dollars>]";
+
+    if (action != "reject" && action != "flag")
+        return "unknown action " + action;
+    rule.reject = action == "reject";
+
+    if (subject == "account")
+        rule.subject = VelocityAccount;
+    else if (subject == "admin")
+        rule.subject = VelocityAdmin;
+    else if (subject == "seller")
+        rule.subject = VelocitySeller;
+    else
+        return "unknown subject " + subject;
+
+    if (operation == "refund")
+        rule.operation = VelocityRefund;
+    else if (operation == "credit")
+        rule.operation = VelocityCredit;
+    else if (operation == "any")
+        rule.operation = VelocityAny;
+    else
+        return "unknown operation " + operation;
+
+    if (!parseVelocityWindow(window, rule.window))
+        return "invalid window " + window;
+
+    std::string limit;
+    bool limited = false;
+    while (fields >> limit)
+    {
+        size_t count = 0;
+        if (limit.compare(0, 6, "count=") == 0 && parseCount(limit.substr(6), 1, 999999999, count))
+            rule.maxCount = count;
+        else if (limit.compare(0, 7, "amount=") != 0 || !parseDecimalCents(limit.substr(7), rule.maxCents))
+            return "invalid limit " + limit;
+        limited = true;
+    }
+    if (!limited)
+        return "a count or amount limit is required";
+
+    rule.text = line;
+    return "";
+}
+
+// Sliding-window limits on refunds and credit grants, checked before the money moves
+class VelocityGuard
+{
+public:
+    // Constructor that takes the rules file (none if empty), the file flagged movements are appended
+    // to and the file the movements are kept in between runs
+    VelocityGuard(const std::string &rulesFilename, const std::string &flagsFilename, const std::string &movementsFilename)
+        : flagsFilename(flagsFilename), movementsFilename(movementsFilename)
+    {
+        if (!rulesFilename.empty())
+            loadRules(rulesFilename);
+        if (!rules.empty())
+            loadMovements();
+    }
+
+    // Function to check a batch of movements against every rule, as if applied together
+    // Returns the message of the first rejecting rule broken, or an empty string if the batch may go ahead
+    std::string check(const std::vector<VelocityEvent> &events)
+    {
+        TimePoint now = Clock::now();
+        std::vector<std::string> flags;
+        for (size_t index = 0; index < rules.size(); index++)
+        {
+            const VelocityRule &rule = rules[index];
+
+            // Totals per subject over the window, including the earlier movements of the batch
+            std::unordered_map<std::string, std::pair<uint64_t, int64_t>> batchTotals;
+            for (const VelocityEvent &event : events)
+            {
+                std::string subject = getSubject(rule, event);
+                if (subject.empty())
+                    continue;
+
+                auto total = batchTotals.find(subject);
+                if (total == batchTotals.end())
+                {
+                    Window &window = getWindow(index, subject);
+                    expire(window, now - rule.window);
+                    total = batchTotals.emplace(subject, std::make_pair(window.count, window.cents)).first;
+                }
+                total->second.first++;
+                total->second.second += event.cents;
+
+                if (total->second.first <= rule.maxCount && total->second.second <= rule.maxCents)
+                    continue;
+                if (rule.reject)
+                    return "Limit reached for " + subject + " (" + rule.text + ").";
+                flags.push_back(subject + ' ' + formatCents(event.cents) + ' ' + rule.text);
+            }
+        }
+
+        for (const std::string &flag : flags)
+            writeFlag(flag);
+        return "";
+    }
+
+    // Function to count a batch of movements that was checked and applied
+    void record(const std::vector<VelocityEvent> &events)
+    {
+        if (rules.empty())
+            return;
+
+        TimePoint now = Clock::now();
+        std::string lines;
+        for (const VelocityEvent &event : events)
+        {
+            addMovement(event, now);
+            lines += formatMovement(event, now);
+        }
+
+        std::ofstream movementsFile(movementsFilename, std::ios::app);
+        movementsFile << lines;
+        if (movementsFile.fail())
+            std::cerr << "Error: Unable to write the velocity movements file." << std::endl;
+    }
+
+    // Function to get the number of rules in force
+    size_t getRuleCount() const
+    {
+        return rules.size();
+    }
+
+private:
+    // Wall-clock time, so movements from earlier runs can be placed in the windows
+    typedef std::chrono::system_clock Clock;
+    typedef Clock::time_point TimePoint;
+
+    struct Movement
+    {
+        TimePoint time;
+        int64_t cents;
+    };
+
+    // Movements of one subject still inside a rule's window, with their count and total
+    struct Window
+    {
+        std::deque<Movement> movements;
+        uint64_t count = 0;
+        int64_t cents = 0;
+    };
+
+    std::vector<VelocityRule> rules;
+
+    // Windows by rule, then by subject
+    std::vector<std::unordered_map<std::string, Window>> windows;
+
+    std::string flagsFilename;
+    std::string movementsFilename;
+
+    // Function to read the rules file, one rule per line; blank lines and lines starting with # are skipped
+    void loadRules(const std::string &rulesFilename)
+    {
+        std::ifstream rulesFile(rulesFilename);
+        if (!rulesFile.is_open())
+        {
+            std::cerr << "Error: Unable to open the velocity rules file " << rulesFilename << "." << std::endl;
+            return;
+        }
+
+        std::string line;
+        size_t lineNumber = 0;
+        while (std::getline(rulesFile, line))
+        {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            size_t first = line.find_first_not_of(" \t");
+            if (first == std::string::npos || line[first] == '#')
+                continue;
+
+            VelocityRule rule;
+            std::string error = parseVelocityRule(line.substr(first), rule);
+            if (!error.empty())
+            {
+                std::cerr << "Error: Skipping velocity rule on line " << lineNumber << ": " << error << std::endl;
+                continue;
+            }
+            rules.push_back(rule);
+        }
+        windows.resize(rules.size());
+    }
+
+    // Function to count one movement in the window of every rule covering it
+    void addMovement(const VelocityEvent &event, TimePoint time)
+    {
+        for (size_t index = 0; index < rules.size(); index++)
+        {
+            std::string subject = getSubject(rules[index], event);
+            if (subject.empty())
+                continue;
+
+            Window &window = getWindow(index, subject);
+            window.movements.push_back(Movement{time, event.cents});
+            window.count++;
+            window.cents += event.cents;
+        }
+    }
+
+    // Function to format a movement as a line of the movements file
+    // Format: <seconds since the epoch> TAB <refund|credit> TAB <cents> TAB <account> TAB <admin> TAB <seller>
+    static std::string formatMovement(const VelocityEvent &event, TimePoint time)
+    {
+        return std::to_string(std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count()) + '\t' +
+               (event.operation == VelocityRefund ? "refund" : "credit") + '\t' + std::to_string(event.cents) + '\t' +
+               event.accountUsername + '\t' + event.adminUsername + '\t' + event.sellerUsername + '\n';
+    }
+
+    // Function to parse a line of the movements file; returns false if it is malformed
+    static bool parseMovement(const std::string &line, VelocityEvent &event, TimePoint &time)
+    {
+        std::vector<std::string> fields;
+        std::istringstream lineStream(line);
+        std::string field;
+        while (std::getline(lineStream, field, '\t'))
+            fields.push_back(field);
+        if (!line.empty() && line.back() == '\t')
+            fields.push_back("");
+        if (fields.size() != 6 || (fields[1] != "refund" && fields[1] != "credit"))
+            return false;
+
+        try
+        {
+            time = TimePoint(std::chrono::seconds(std::stoll(fields[0])));
+            event.cents = std::stoll(fields[2]);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+        event.operation = fields[1] == "refund" ? VelocityRefund : VelocityCredit;
+        event.accountUsername = fields[3];
+        event.adminUsername = fields[4];
+        event.sellerUsername = fields[5];
+        return true;
+    }
+
+    // Function to put the movements of earlier runs back in the windows, and rewrite the movements
+    // file with only those still inside the longest window
+    void loadMovements()
+    {
+        std::chrono::seconds longestWindow{0};
+        for (const VelocityRule &rule : rules)
+            longestWindow = std::max(longestWindow, rule.window);
+        TimePoint start = Clock::now() - longestWindow;
+
+        std::ifstream movementsFile(movementsFilename);
+        if (!movementsFile.is_open())
+            return;
+
+        std::string kept;
+        std::string line;
+        bool trimmed = false;
+        while (std::getline(movementsFile, line))
+        {
+            VelocityEvent event;
+            TimePoint time;
+            if (!parseMovement(line, event, time) || time < start)
+            {
+                trimmed = true;
+                continue;
+            }
+            addMovement(event, time);
+            kept += line + '\n';
+        }
+        movementsFile.close();
+
+        if (!trimmed)
+            return;
+
+        std::string tempFilename = movementsFilename + ".tmp";
+        std::ofstream trimmedFile(tempFilename, std::ios::trunc);
+        trimmedFile << kept;
+        trimmedFile.close();
+        if (trimmedFile.fail() || std::rename(tempFilename.c_str(), movementsFilename.c_str()) != 0)
+        {
+            std::cerr << "Error: Unable to trim the velocity movements file." << std::endl;
+            std::remove(tempFilename.c_str());
+        }
+    }
+
+    // Function to get whose totals an event adds to under a rule, or an empty string if the rule does not cover it
+    static std::string getSubject(const VelocityRule &rule, const VelocityEvent &event)
+    {
+        if (rule.operation != VelocityAny && rule.operation != event.operation)
+            return "";
+        if (rule.subject == VelocityAccount)
+            return event.accountUsername;
+        if (rule.subject == VelocityAdmin)
+            return event.adminUsername;
+        return event.sellerUsername;
+    }
+
+    Window &getWindow(size_t rule, const std::string &subject)
+    {
+        return windows[rule][subject];
+    }
+
+    // Function to drop the movements older than the start of the window
+    static void expire(Window &window, TimePoint start)
+    {
+        while (!window.movements.empty() && window.movements.front().time < start)
+        {
+            window.count--;
+            window.cents -= window.movements.front().cents;
+            window.movements.pop_front();
+        }
+    }
+
+    static std::string formatCents(int64_t cents)
+    {
+        std::ostringstream amount;
+        amount << std::fixed << std::setprecision(2) << centsToAmount(cents);
+        return amount.str();
+    }
+
+    // Function to append a flagged movement with the time it happened
+    void writeFlag(const std::string &flag)
+    {
+        std::time_t now = std::time(nullptr);
+        char timestamp[32];
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+        std::ofstream flagsFile(flagsFilename, std::ios::app);
+        flagsFile << timestamp << ' ' << flag << '\n';
+        if (flagsFile.fail())
+            std::cerr << "Error: Unable to write the velocity flag file." << std::endl;
+    }
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <cstdint>
 #include <string>
 
 // Enumeration representing different user types
@@ -13,61 +14,93 @@ enum UserType
     AccountManager // Account Manager User
 };
 
-// Array of user type codes corresponding to the UserType enum
-const char *userTypes[] = {"AA", "FS", "BS", "SS", "AM"};
+// Number of user types in the UserType enum
+constexpr int userTypeCount = 5;
 
-// Function to map a user type code to the corresponding UserType enum value
-int getUserTypeFromCode(std::string code)
+// Description of a user type: the 2-character code used in the files and the name shown to users
+struct UserTypeInfo
 {
-    if (code == userTypes[Admin])
+    UserType type;
+    char code[3];
+    const char *fullName;
+};
+
+// Table of user types, indexed by the UserType enum
+constexpr UserTypeInfo userTypeTable[userTypeCount] = {
+    {Admin, "AA", "Admin"},
+    {FullStandard, "FS", "Full-Standard"},
+    {BuyStandard, "BS", "Buy-Standard"},
+    {SellStandard, "SS", "Sell-Standard"},
+    {AccountManager, "AM", "Account-Manager"},
+};
+
+// Function to pack a 2-character user type code into one 16-bit key
+constexpr uint16_t userCodeKey(char first, char second)
+{
+    return static_cast<uint16_t>(static_cast<unsigned char>(first) << 8 | static_cast<unsigned char>(second));
+}
+
+// Function to map a user type code to the corresponding UserType enum value, or -1 if it is unknown
+constexpr int getUserTypeFromCode(char first, char second)
+{
+    switch (userCodeKey(first, second))
+    {
+    case userCodeKey('A', 'A'):
         return Admin;
-    else if (code == userTypes[FullStandard])
+    case userCodeKey('F', 'S'):
         return FullStandard;
-    else if (code == userTypes[BuyStandard])
+    case userCodeKey('B', 'S'):
         return BuyStandard;
-    else if (code == userTypes[SellStandard])
+    case userCodeKey('S', 'S'):
         return SellStandard;
-    else if (code == userTypes[AccountManager])
+    case userCodeKey('A', 'M'):
         return AccountManager;
+    default:
+        return -1;
+    }
+}
 
-    // Return an invalid value if the code doesn't match any known user type
-    return -1;
+inline int getUserTypeFromCode(const std::string &code)
+{
+    return code.length() == 2 ? getUserTypeFromCode(code[0], code[1]) : -1;
 }
 
-// Function to map a UserType enum value to corresponding user type code
-std::string getUserCodeFromType(int type)
+// Function to check whether a value is one of the UserType enum values
+constexpr bool isValidUserType(int type)
 {
-    if (type == Admin)
-        return userTypes[Admin];
-    else if (type == FullStandard)
-        return userTypes[FullStandard];
-    else if (type == BuyStandard)
-        return userTypes[BuyStandard];
-    else if (type == SellStandard)
-        return userTypes[SellStandard];
-    else if (type == AccountManager)
-        return userTypes[AccountManager];
+    return type >= 0 && type < userTypeCount;
+}
 
-    // Return an invalid value if the code doesn't match any known user type
-    return "";
+// Function to map a UserType enum value to the corresponding user type code, or "" if it is unknown
+constexpr const char *getUserCodeFromType(int type)
+{
+    return isValidUserType(type) ? userTypeTable[type].code : "";
 }
 
-// Function to get a string of the user type
-std::string getFullUserType(int type)
+// Function to get a string of the user type, or "" if it is unknown
+constexpr const char *getFullUserType(int type)
 {
-    if (type == Admin)
-        return "Admin";
-    else if (type == FullStandard)
-        return "Full-Standard";
-    else if (type == BuyStandard)
-        return "Buy-Standard";
-    else if (type == SellStandard)
-        return "Sell-Standard";
-    else if (type == AccountManager)
-        return "Account-Manager";
+    return isValidUserType(type) ? userTypeTable[type].fullName : "";
+}
 
-    // Return an invalid value if the code doesn't match any known user type
-    return "";
+// Function to map a user type as numbered in the create menu (from 1) to the UserType enum value, or -1
+constexpr int getUserTypeFromMenuNumber(int number)
+{
+    return isValidUserType(number - 1) ? number - 1 : -1;
 }
 
+// Function to check that the table, the code switch and the enum all agree
+constexpr bool userTypeTableIsConsistent()
+{
+    for (int type = 0; type < userTypeCount; type++)
+    {
+        const UserTypeInfo &info = userTypeTable[type];
+        if (info.type != type || getUserTypeFromCode(info.code[0], info.code[1]) != type)
+            return false;
+    }
+    return true;
+}
+
+static_assert(userTypeTableIsConsistent(), "userTypeTable is out of step with the UserType enum");
+
 #endif
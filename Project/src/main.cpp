@@ -4,14 +4,17 @@
 #include "FileReader.h"
 #include "User.h"
 #include "SharedData.h"
+#include "Options.h"
 
 // Updated to use command-line arguments
 int main(int argc, char *argv[])
 {
     // Check if the correct number of arguments is passed
-    if (argc < 5)
+    Options options;
+    if (argc < 5 || !parseOptions(argc, argv, 5, options))
     {
-        std::cerr << "Usage: " << argv[0] << " <users_filename>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <users_filename> <available_games_filename> <games_collection_filename> <transactions_filename>"
+                  << " [--lazy-collections] [--watch] [--sort-memory=<records>] [--velocity-rules=<file>] [--change-feed] [--follow=<socket>] [--shards=<n>] [--binary-journal]" << std::endl;
         return 1; // Return with error code
     }
 
@@ -25,7 +28,14 @@ int main(int argc, char *argv[])
     SharedData sharedData;
 
     // Create an instance of TransactionHandler, providing SharedData and the filename for user data
-    TransactionHandler handler(sharedData, currentAccountsFilename, availableGamesFilename, gamesCollectionFilename, transactionsOutFilename);
+    TransactionHandler handler(sharedData, currentAccountsFilename, availableGamesFilename, gamesCollectionFilename, transactionsOutFilename, options);
+
+    // A master file failed validation; stop rather than run on part of the data
+    if (sharedData.isLoadFailed())
+    {
+        std::cerr << "Error: A master file failed validation. Repair it and restart the program." << std::endl;
+        return 1;
+    }
 
     // Main program loop
     while (true)
@@ -1171,4 +1171,124 @@ def test_PC10_game_price_deducted_from_buyer_account():
     with open(user_accounts_file, 'r') as file:
         file.readline()  # Read and discard the first line
         second_line = file.readline().strip()
-    assert "TestUser3        BS 001350.00" in second_line
\ No newline at end of file
+    assert "TestUser3        BS 001350.00" in second_line
+#Test Case 36
+def journal_frame(sequence, code, fields, cents):
+    # Frame a record as the front end writes it to the binary journal
+    import struct
+    import TransactionJournal
+
+    payload = struct.pack('<QBB', sequence, code, len(fields))
+    for field in fields:
+        payload += struct.pack('<H', len(field)) + field.encode()
+    payload += struct.pack('<q', cents)
+    return struct.pack('<II', len(payload), TransactionJournal.crc32c(payload)) + payload
+
+
+def write_journal_day(directory, frames, text):
+    # Write a day's binary journal and its text file, and master files holding one admin account
+    import struct
+
+    transactions_file = directory / "dailytransactions.txt.bin"
+    transactions_file.write_bytes(b'SDTJ' + struct.pack('<I', 1) + b''.join(frames))
+    (directory / "dailytransactions.txt").write_text(text)
+    (directory / "currentaccounts.txt").write_text("TestUser         AA 000909.00\nEND                          ")
+    (directory / "availablegames.txt").write_text("END                                              ")
+    (directory / "gamescollection.txt").write_text("")
+    return transactions_file
+
+
+def process_journal_day(directory):
+    Transactions.process_transactions(str(directory / "dailytransactions.txt.bin"), str(directory / "currentaccounts.txt"),
+                                      str(directory / "availablegames.txt"), str(directory / "gamescollection.txt"))
+
+
+def test_binary_journal_processed_at_full_length(tmp_path, capsys):
+    import TransactionJournal
+
+    # A sell of a game whose name is longer than its column in the text file
+    transactions_file = write_journal_day(tmp_path,
+                                          [journal_frame(1, 3, ["A Very Long Game Name", "TestUser"], 2050),
+                                           journal_frame(2, 0, ["TestUser", "AA"], 90900)],
+                                          "03 A Very Long Game Na TestUser      020.50\n00 TestUser        AA 000909.00\n")
+    process_journal_day(tmp_path)
+
+    assert capsys.readouterr().out == "Sell game transaction\nEnd of transactions file\n"
+    assert (tmp_path / "availablegames.txt").read_text().startswith("A Very Long Game Name     TestUser         020.50\n")
+
+    # The converter writes the truncated text records
+    assert TransactionJournal.legacy_lines(str(transactions_file)) == [
+        "03 A Very Long Game Na TestUser      020.50\n",
+        "00 TestUser        AA 000909.00\n"]
+
+    # A torn final frame is dropped and the records before it are kept, but the journal is not whole
+    transactions_file.write_bytes(transactions_file.read_bytes()[:-4])
+    records, whole = TransactionJournal.read_journal(str(transactions_file))
+    assert [record[0] for record in records] == [1] and not whole
+
+#Test Case 37
+def test_binary_journal_corrupt_frame_falls_back_to_text(tmp_path, capsys):
+    frames = [journal_frame(1, 1, ["NewUser", "FS"], 0),
+              journal_frame(2, 3, ["Journal Game", "TestUser"], 1000),
+              journal_frame(3, 0, ["TestUser", "AA"], 90900)]
+
+    # Damage a byte of the middle frame's payload, keeping the frame after it
+    corrupt = bytearray(frames[1])
+    corrupt[-3] ^= 0xFF
+    frames[1] = bytes(corrupt)
+    write_journal_day(tmp_path, frames, "01 NewUser         FS 000000.00\n\
+03 Text Game           TestUser      010.00\n\
+00 TestUser        AA 000909.00\n")
+    process_journal_day(tmp_path)
+
+    # The whole day is processed from the text file, not the records before the corrupt frame
+    output = capsys.readouterr().out
+    assert "ERROR: Corrupt frame at byte" in output
+    assert f"ERROR: The binary journal cannot be used; processing {tmp_path / 'dailytransactions.txt'} instead." in output
+    assert output.endswith("Create user account transaction\nSell game transaction\nEnd of transactions file\n")
+    assert "NewUser          FS 000000.00" in (tmp_path / "currentaccounts.txt").read_text()
+    assert (tmp_path / "availablegames.txt").read_text().startswith("Text Game")
+
+#Test Case 38
+def test_binary_journal_behind_text_falls_back_to_text(tmp_path, capsys):
+    # The front end stopped writing the journal after the first session
+    write_journal_day(tmp_path, [journal_frame(1, 0, ["TestUser", "AA"], 90900)],
+                      "00 TestUser        AA 000909.00\n01 NewUser         FS 000000.00\n00 TestUser        AA 000909.00\n")
+    process_journal_day(tmp_path)
+
+    output = capsys.readouterr().out
+    assert "holds 1 records but" in output and "holds 3" in output
+    assert "NewUser          FS 000000.00" in (tmp_path / "currentaccounts.txt").read_text()
+
+#Test Case 39
+def test_front_end_binary_journal_processed(tmp_path, capsys):
+    import shutil
+    import subprocess
+    import pytest
+
+    if shutil.which('g++') is None:
+        pytest.skip("g++ is not available to build the front end")
+    project = Path(__file__).resolve().parent.parent
+    front_end = tmp_path / "distribution-system"
+    subprocess.run(['g++', '-std=c++17', '-pthread', '-o', str(front_end), str(project / 'src' / 'main.cpp')], check=True)
+
+    # Run a session on copies of the master files; the backend starts from another copy of them, without blank lines
+    session = tmp_path / "session"
+    session.mkdir()
+    for name in ["currentaccounts.txt", "availablegames.txt", "gamescollection.txt"]:
+        shutil.copy(project / 'data' / name, session / name)
+        lines = (project / 'data' / name).read_text().splitlines(True)
+        (tmp_path / name).write_text(''.join(line for line in lines if line.strip()))
+    (session / "dailytransactions.txt").write_text("")
+    subprocess.run([str(front_end), "currentaccounts.txt", "availablegames.txt", "gamescollection.txt", "dailytransactions.txt",
+                    "--binary-journal"], cwd=session, check=True, capture_output=True, timeout=60,
+                   input="login\nadmin\ncreate\nnewgamer\n2\nsell\nThe Longest Game Ever\n15.50\nlogout\nexit\n", text=True)
+    shutil.copy(session / "dailytransactions.txt", tmp_path / "dailytransactions.txt")
+    shutil.copy(session / "dailytransactions.txt.bin", tmp_path / "dailytransactions.txt.bin")
+    capsys.readouterr()
+
+    process_journal_day(tmp_path)
+
+    assert capsys.readouterr().out == "Create user account transaction\nSell game transaction\nEnd of transactions file\n"
+    assert "newgamer         FS 000000.00" in (tmp_path / "currentaccounts.txt").read_text()
+    assert "The Longest Game Ever     admin            015.50" in (tmp_path / "availablegames.txt").read_text()